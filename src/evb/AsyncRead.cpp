@@ -0,0 +1,226 @@
+/*
+	AsyncRead.cpp
+	io_uring and thread pool backends for AsyncRead. See header.
+*/
+#include "AsyncRead.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <unistd.h>
+#ifdef EVB_USE_IO_URING
+#include <liburing.h>
+#endif
+
+namespace EventBuilder {
+
+	/*
+		Fallback backend. A handful of threads is plenty: each read is a large sequential pread, and there is at most
+		one outstanding per open file.
+	*/
+	class IOThreadPool
+	{
+	public:
+		static IOThreadPool& GetInstance()
+		{
+			static IOThreadPool pool;
+			return pool;
+		}
+
+		void Submit(std::function<void()>&& job)
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				m_jobs.push_back(std::move(job));
+			}
+			m_condition.notify_one();
+		}
+
+	private:
+		IOThreadPool() :
+			m_stop(false)
+		{
+			unsigned int nThreads = std::clamp(std::thread::hardware_concurrency(), 1u, s_maxThreads);
+			for(unsigned int i=0; i<nThreads; i++)
+				m_threads.emplace_back(&IOThreadPool::Work, this);
+		}
+
+		~IOThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				m_stop = true;
+			}
+			m_condition.notify_all();
+			for(auto& thread : m_threads)
+				thread.join();
+		}
+
+		void Work()
+		{
+			while(true)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> guard(m_mutex);
+					m_condition.wait(guard, [this]() { return m_stop || !m_jobs.empty(); });
+					if(m_jobs.empty())
+						return;
+					job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+				}
+				job();
+			}
+		}
+
+		std::vector<std::thread> m_threads;
+		std::deque<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_stop;
+
+		static constexpr unsigned int s_maxThreads = 4;
+	};
+
+#ifdef EVB_USE_IO_URING
+	/*
+		One ring per thread, since a ring has a single submitter. Completions can come back for any of the thread's
+		reads, so Wait() reaps until its own has arrived, marking the others done along the way. Reads keep a
+		pointer to their ring, so they are always reaped from the ring they were queued on.
+	*/
+	class RingQueue
+	{
+	public:
+		static RingQueue& GetInstance()
+		{
+			thread_local RingQueue queue;
+			return queue;
+		}
+
+		inline bool IsValid() const { return m_isValid; }
+
+		bool Submit(AsyncRead* read, int fd, char* dest, std::size_t size, uint64_t offset)
+		{
+			io_uring_sqe* sqe = io_uring_get_sqe(&m_ring);
+			if(sqe == nullptr) //queue full; flush what we have and try once more
+			{
+				io_uring_submit(&m_ring);
+				sqe = io_uring_get_sqe(&m_ring);
+				if(sqe == nullptr)
+					return false;
+			}
+			io_uring_prep_read(sqe, fd, dest, size, offset);
+			io_uring_sqe_set_data(sqe, read);
+			return io_uring_submit(&m_ring) >= 0;
+		}
+
+		void Wait(AsyncRead* read)
+		{
+			while(!read->m_done)
+			{
+				io_uring_cqe* cqe = nullptr;
+				int status = io_uring_wait_cqe(&m_ring, &cqe);
+				if(status == -EINTR)
+					continue;
+				else if(status < 0)
+				{
+					read->m_result = -1;
+					read->m_done = true;
+					return;
+				}
+				AsyncRead* owner = static_cast<AsyncRead*>(io_uring_cqe_get_data(cqe));
+				owner->m_result = cqe->res < 0 ? -1 : cqe->res;
+				owner->m_done = true;
+				io_uring_cqe_seen(&m_ring, cqe);
+			}
+		}
+
+	private:
+		RingQueue()
+		{
+			m_isValid = io_uring_queue_init(s_queueDepth, &m_ring, 0) == 0;
+			if(!m_isValid)
+				EVB_WARN("Unable to set up io_uring, falling back to I/O threads for file reads.");
+		}
+
+		~RingQueue()
+		{
+			if(m_isValid)
+				io_uring_queue_exit(&m_ring);
+		}
+
+		io_uring m_ring;
+		bool m_isValid;
+
+		static constexpr unsigned int s_queueDepth = 256;
+	};
+#endif
+
+	AsyncRead::AsyncRead() :
+		m_pending(false), m_ring(nullptr), m_done(false), m_result(0)
+	{
+	}
+
+	AsyncRead::~AsyncRead()
+	{
+		Wait();
+	}
+
+	void AsyncRead::Start(int fd, char* dest, std::size_t size, uint64_t offset)
+	{
+		Wait(); //one read at a time
+		m_pending = true;
+		m_done = false;
+		m_result = 0;
+
+#ifdef EVB_USE_IO_URING
+		RingQueue& ring = RingQueue::GetInstance();
+		if(ring.IsValid() && ring.Submit(this, fd, dest, size, offset))
+		{
+			m_ring = &ring;
+			return;
+		}
+#endif
+		m_ring = nullptr;
+		auto task = std::make_shared<std::packaged_task<long()>>([=]() { return ReadFully(fd, dest, size, offset); });
+		m_future = task->get_future();
+		IOThreadPool::GetInstance().Submit([task]() { (*task)(); });
+	}
+
+	long AsyncRead::Wait()
+	{
+		if(!m_pending)
+			return 0;
+		m_pending = false;
+
+#ifdef EVB_USE_IO_URING
+		if(m_ring != nullptr)
+		{
+			m_ring->Wait(this); //the ring of the thread that started the read, not necessarily ours
+			return m_result;
+		}
+#endif
+		return m_future.get();
+	}
+
+	long AsyncRead::ReadFully(int fd, char* dest, std::size_t size, uint64_t offset)
+	{
+		std::size_t total = 0;
+		while(total < size)
+		{
+			ssize_t nread = ::pread(fd, dest + total, size - total, offset + total);
+			if(nread < 0 && errno == EINTR)
+				continue;
+			else if(nread < 0)
+				return -1;
+			else if(nread == 0)
+				break;
+			total += nread;
+		}
+		return total;
+	}
+
+}
@@ -0,0 +1,47 @@
+/*
+	AsyncRead.h
+	One outstanding positional read (pread) into a caller owned buffer, used by CompassFile to fill its next buffer
+	while the current one is being parsed. When built with EVB_USE_IO_URING the read is queued on an io_uring owned
+	by the thread calling Start(); otherwise, or if the ring can't be set up at runtime, it is handed to a small shared
+	pool of I/O threads. The read remembers its ring, so Wait() reaps from it whichever thread calls it, but not while
+	the starting thread is using that ring.
+
+	The destination buffer must stay put until Wait() returns. An AsyncRead can't be copied or moved while a read is
+	pending, so owners that need to be copyable should hold it through a pointer.
+*/
+#ifndef ASYNC_READ_H
+#define ASYNC_READ_H
+
+#include <future>
+
+namespace EventBuilder {
+
+	class RingQueue;
+
+	class AsyncRead
+	{
+	public:
+		AsyncRead();
+		~AsyncRead(); //waits for any pending read, the buffer may be going away with us
+		AsyncRead(const AsyncRead&) = delete;
+		AsyncRead& operator=(const AsyncRead&) = delete;
+
+		void Start(int fd, char* dest, std::size_t size, uint64_t offset);
+		long Wait(); //bytes read (0 at end of file, -1 on error); returns 0 straight away if nothing is pending
+		inline bool IsPending() const { return m_pending; }
+
+		static long ReadFully(int fd, char* dest, std::size_t size, uint64_t offset); //blocking pread until size or EOF
+
+	private:
+		friend class RingQueue;
+
+		bool m_pending;
+		RingQueue* m_ring; //io_uring the read was queued on, nullptr if it went to the thread pool
+		bool m_done; //set by the ring when our completion is reaped
+		long m_result;
+		std::future<long> m_future;
+	};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+	BuiltEvent.cpp
+	Grouping of staged hits into the per-detector layout. See header.
+*/
+#include "BuiltEvent.h"
+#include <algorithm>
+
+namespace EventBuilder {
+
+	BuiltEvent::BuiltEvent() :
+		m_offsets(1, 0)
+	{
+	}
+
+	BuiltEvent::~BuiltEvent() {}
+
+	void BuiltEvent::Clear()
+	{
+		m_detectors.clear();
+		m_offsets.assign(1, 0);
+		m_hits.clear();
+		m_staged.clear();
+	}
+
+	//Events hold few hits, so a stable sort of the staged hits is cheaper than per-detector bookkeeping
+	void BuiltEvent::Assemble()
+	{
+		std::stable_sort(m_staged.begin(), m_staged.end(), [](const StagedHit& a, const StagedHit& b) { return a.detector < b.detector; });
+
+		m_detectors.clear();
+		m_offsets.assign(1, 0);
+		m_hits.clear();
+		m_hits.reserve(m_staged.size());
+		for(auto& staged : m_staged)
+		{
+			if(m_detectors.empty() || m_detectors.back() != staged.detector)
+			{
+				if(!m_detectors.empty())
+					m_offsets.push_back(m_hits.size());
+				m_detectors.push_back(staged.detector);
+			}
+			m_hits.push_back(staged.hit);
+		}
+		if(!m_detectors.empty())
+			m_offsets.push_back(m_hits.size());
+		m_staged.clear();
+	}
+
+	HitRange BuiltEvent::GetHits(int detector) const
+	{
+		auto iter = std::lower_bound(m_detectors.begin(), m_detectors.end(), detector);
+		if(iter == m_detectors.end() || *iter != detector)
+			return HitRange();
+		return GetHitsAt(iter - m_detectors.begin());
+	}
+
+	//Lists are nearly always a handful of hits, where an inline insertion sort beats std::sort's setup
+	void BuiltEvent::SortByEnergy(std::size_t index)
+	{
+		DetectorHit* first = m_hits.data() + m_offsets[index];
+		DetectorHit* last = m_hits.data() + m_offsets[index + 1];
+		if(last - first > s_insertionSortLimit)
+		{
+			std::sort(first, last, [](const DetectorHit& i, const DetectorHit& j) { return i.Long > j.Long; });
+			return;
+		}
+
+		for(DetectorHit* current = first + 1; current < last; current++)
+		{
+			DetectorHit hit = *current;
+			DetectorHit* position = current;
+			while(position > first && (position - 1)->Long < hit.Long)
+			{
+				*position = *(position - 1);
+				--position;
+			}
+			*position = hit;
+		}
+	}
+
+}
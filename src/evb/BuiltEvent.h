@@ -0,0 +1,63 @@
+/*
+	BuiltEvent.h
+	Sparse, detector indexed form of a built event. Hits are stored contiguously grouped by detector ID (see
+	DetectorRegistry), with a sorted list of the detectors that fired and the offset of each one's hits. An event
+	costs space only for the detectors present in it, however many the channel map defines.
+
+	Hits are staged with AddHit() and grouped by Assemble(); within a detector they keep their staging (time) order
+	unless sorted afterwards.
+*/
+#ifndef BUILT_EVENT_H
+#define BUILT_EVENT_H
+
+#include "DataStructs.h"
+
+namespace EventBuilder {
+
+	struct HitRange
+	{
+		const DetectorHit* first = nullptr;
+		const DetectorHit* last = nullptr;
+
+		inline const DetectorHit* begin() const { return first; }
+		inline const DetectorHit* end() const { return last; }
+		inline std::size_t size() const { return last - first; }
+		inline bool empty() const { return first == last; }
+		inline const DetectorHit& operator[](std::size_t i) const { return first[i]; }
+	};
+
+	class BuiltEvent
+	{
+	public:
+		BuiltEvent();
+		~BuiltEvent();
+
+		void Clear();
+		inline void AddHit(int detector, const DetectorHit& hit) { m_staged.push_back({detector, hit}); }
+		void Assemble();
+
+		inline std::size_t GetNumberOfDetectors() const { return m_detectors.size(); } //detectors with hits
+		inline std::size_t GetNumberOfHits() const { return m_hits.size(); }
+		inline int GetDetector(std::size_t index) const { return m_detectors[index]; }
+		inline HitRange GetHitsAt(std::size_t index) const { return { m_hits.data() + m_offsets[index], m_hits.data() + m_offsets[index + 1] }; }
+		HitRange GetHits(int detector) const; //empty if the detector has no hits in this event
+		void SortByEnergy(std::size_t index); //descending Long, for the detector at index
+
+		static constexpr std::ptrdiff_t s_insertionSortLimit = 16; //longer lists fall back to std::sort
+
+	private:
+		struct StagedHit
+		{
+			int detector;
+			DetectorHit hit;
+		};
+
+		std::vector<int> m_detectors; //ascending
+		std::vector<uint32_t> m_offsets; //m_detectors.size() + 1 entries
+		std::vector<DetectorHit> m_hits;
+		std::vector<StagedHit> m_staged;
+	};
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+	BuiltFileReader.cpp
+	Reads full or compact built files. See header.
+*/
+#include "BuiltFileReader.h"
+#include "CompactEvent.h"
+
+namespace EventBuilder {
+
+	BuiltFileReader::BuiltFileReader() :
+		m_file(nullptr), m_tree(nullptr), m_event(new CoincEvent()), m_compact(new CompactEvent()), m_isCompact(false)
+	{
+	}
+
+	BuiltFileReader::BuiltFileReader(const std::string& filename) :
+		BuiltFileReader()
+	{
+		Open(filename);
+	}
+
+	BuiltFileReader::~BuiltFileReader()
+	{
+		Close();
+		delete m_event;
+		delete m_compact;
+	}
+
+	bool BuiltFileReader::Open(const std::string& filename)
+	{
+		Close();
+		m_file = TFile::Open(filename.c_str(), "READ");
+		if(m_file == nullptr || !m_file->IsOpen() || m_file->IsZombie())
+		{
+			EVB_ERROR("Unable to open built file {0} at BuiltFileReader::Open()!", filename);
+			Close();
+			return false;
+		}
+
+		m_tree = (TTree*) m_file->Get("SortTree");
+		if(m_tree == nullptr)
+		{
+			EVB_ERROR("No SortTree in {0} at BuiltFileReader::Open()!", filename);
+			Close();
+			return false;
+		}
+
+		if(m_tree->GetBranch("compactEvent") != nullptr)
+		{
+			m_isCompact = true;
+			m_tree->SetBranchAddress("compactEvent", &m_compact);
+		}
+		else
+		{
+			m_isCompact = false;
+			m_tree->SetBranchAddress("event", &m_event);
+		}
+		return true;
+	}
+
+	void BuiltFileReader::Close()
+	{
+		if(m_file != nullptr)
+		{
+			m_file->Close();
+			delete m_file;
+		}
+		m_file = nullptr;
+		m_tree = nullptr;
+		m_isCompact = false;
+	}
+
+	const CoincEvent& BuiltFileReader::GetEntry(Long64_t entry)
+	{
+		m_tree->GetEntry(entry);
+		if(!m_isCompact)
+			return *m_event;
+
+		DecodeCompactEvent(*m_compact, m_decoded);
+		return m_decoded;
+	}
+
+}
@@ -0,0 +1,37 @@
+/*
+	BuiltFileReader.h
+	Reads built (sorted) files, SortTree, in either the full CoincEvent form (branch "event") or the compact
+	form (branch "compactEvent"), and hands back CoincEvents either way. Compact events are decoded on load.
+*/
+#ifndef BUILT_FILE_READER_H
+#define BUILT_FILE_READER_H
+
+#include "DataStructs.h"
+
+namespace EventBuilder {
+
+	class BuiltFileReader
+	{
+	public:
+		BuiltFileReader();
+		BuiltFileReader(const std::string& filename);
+		~BuiltFileReader();
+		bool Open(const std::string& filename);
+		void Close();
+		const CoincEvent& GetEntry(Long64_t entry);
+		inline Long64_t GetEntries() const { return m_tree == nullptr ? 0 : m_tree->GetEntries(); }
+		inline bool IsOpen() const { return m_tree != nullptr; }
+		inline bool IsCompact() const { return m_isCompact; }
+
+	private:
+		TFile* m_file;
+		TTree* m_tree;
+		CoincEvent* m_event;
+		CompactEvent* m_compact;
+		CoincEvent m_decoded;
+		bool m_isCompact;
+	};
+
+}
+
+#endif
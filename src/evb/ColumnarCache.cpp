@@ -0,0 +1,274 @@
+/*
+	ColumnarCache.cpp
+	Binary columnar cache of analyzed data. See header for layout.
+*/
+#include "ColumnarCache.h"
+#include <filesystem>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace EventBuilder {
+
+	static const std::string s_manifestName = "manifest.txt";
+	static const std::string s_cacheTag = "EVBColumnarCache";
+	static constexpr int s_cacheVersion = 1;
+
+	//Array elements are named like sabreRingE[0]; keep the file names plain
+	static std::string GetColumnFilename(const std::string& name)
+	{
+		std::string filename;
+		for(char c : name)
+		{
+			if(c == '[')
+				filename += '_';
+			else if(c != ']')
+				filename += c;
+		}
+		return filename + ".col";
+	}
+
+	ColumnarCacheWriter::ColumnarCacheWriter() :
+		m_nEntries(0), m_isOpen(false)
+	{
+	}
+
+	ColumnarCacheWriter::~ColumnarCacheWriter()
+	{
+		Close();
+	}
+
+	bool ColumnarCacheWriter::Open(const std::string& directory)
+	{
+		Close();
+		m_directory = directory;
+		m_nEntries = 0;
+
+		std::error_code ec;
+		std::filesystem::remove_all(m_directory, ec); //never mix columns from an older cache
+		if(!std::filesystem::create_directories(m_directory, ec))
+		{
+			EVB_WARN("Unable to create columnar cache directory {0}; no cache will be written.", m_directory);
+			return false;
+		}
+
+		const auto& fields = GetProcessedEventFields();
+		m_columns.resize(fields.size());
+		for(std::size_t i=0; i<fields.size(); i++)
+		{
+			Column& column = m_columns[i];
+			column.field = &fields[i];
+			column.file = std::fopen((m_directory + "/" + GetColumnFilename(fields[i].name)).c_str(), "wb");
+			column.buffer.reserve(s_bufferSize);
+			if(column.file == nullptr)
+			{
+				EVB_WARN("Unable to open column {0} in cache {1}; no cache will be written.", fields[i].name, m_directory);
+				m_isOpen = true;
+				Close();
+				std::filesystem::remove_all(m_directory, ec);
+				return false;
+			}
+		}
+
+		m_isOpen = true;
+		return true;
+	}
+
+	void ColumnarCacheWriter::Fill(const ProcessedEvent& event)
+	{
+		if(!m_isOpen)
+			return;
+
+		for(auto& column : m_columns)
+		{
+			double value = GetFieldValue(event, *column.field);
+			std::size_t size = column.buffer.size();
+			if(column.field->isTime)
+			{
+				column.buffer.resize(size + sizeof(double));
+				std::memcpy(column.buffer.data() + size, &value, sizeof(double));
+			}
+			else
+			{
+				float fvalue = value;
+				column.buffer.resize(size + sizeof(float));
+				std::memcpy(column.buffer.data() + size, &fvalue, sizeof(float));
+			}
+
+			if(column.buffer.size() + sizeof(double) > s_bufferSize)
+				FlushColumn(column);
+		}
+		++m_nEntries;
+	}
+
+	void ColumnarCacheWriter::FlushColumn(Column& column)
+	{
+		if(column.file != nullptr && !column.buffer.empty())
+			std::fwrite(column.buffer.data(), 1, column.buffer.size(), column.file);
+		column.buffer.clear();
+	}
+
+	void ColumnarCacheWriter::Close()
+	{
+		if(!m_isOpen)
+			return;
+
+		bool allGood = true;
+		for(auto& column : m_columns)
+		{
+			if(column.file == nullptr)
+			{
+				allGood = false;
+				continue;
+			}
+			FlushColumn(column);
+			allGood &= std::ferror(column.file) == 0;
+			std::fclose(column.file);
+			column.file = nullptr;
+		}
+
+		//The manifest is written last, so a cache with a manifest is always complete
+		if(allGood)
+		{
+			std::ofstream manifest(m_directory + "/" + s_manifestName);
+			manifest << s_cacheTag << " " << s_cacheVersion << std::endl;
+			manifest << "entries " << m_nEntries << std::endl;
+			for(auto& column : m_columns)
+				manifest << "column " << column.field->name << " " << (column.field->isTime ? "f8" : "f4") << " " << GetColumnFilename(column.field->name) << std::endl;
+		}
+		else
+			EVB_WARN("Write error in columnar cache {0}; cache not finalized.", m_directory);
+
+		m_columns.clear();
+		m_isOpen = false;
+	}
+
+	ColumnarCacheReader::ColumnarCacheReader() :
+		m_nEntries(0), m_isOpen(false)
+	{
+	}
+
+	ColumnarCacheReader::~ColumnarCacheReader()
+	{
+		Close();
+	}
+
+	std::string ColumnarCacheReader::GetCacheDirectory(const std::string& rootfile)
+	{
+		std::filesystem::path path(rootfile);
+		return path.replace_extension(".cols").string();
+	}
+
+	//A cache is only used if it is complete and at least as new as the ROOT file it mirrors
+	bool ColumnarCacheReader::HasValidCache(const std::string& rootfile)
+	{
+		std::error_code ec;
+		std::filesystem::path manifest = std::filesystem::path(GetCacheDirectory(rootfile)) / s_manifestName;
+		if(!std::filesystem::exists(manifest, ec))
+			return false;
+		auto cacheTime = std::filesystem::last_write_time(manifest, ec);
+		if(ec)
+			return false;
+		auto rootTime = std::filesystem::last_write_time(rootfile, ec);
+		return !ec && cacheTime >= rootTime;
+	}
+
+	bool ColumnarCacheReader::Open(const std::string& directory)
+	{
+		Close();
+		m_directory = directory;
+
+		std::ifstream manifest(m_directory + "/" + s_manifestName);
+		if(!manifest.is_open())
+			return false;
+
+		std::string tag, keyword, name, type, filename;
+		int version = 0;
+		manifest >> tag >> version;
+		if(tag != s_cacheTag || version != s_cacheVersion)
+		{
+			EVB_WARN("Columnar cache {0} has an unknown format ({1} {2}).", m_directory, tag, version);
+			return false;
+		}
+		manifest >> keyword >> m_nEntries;
+		while(manifest >> keyword >> name >> type >> filename)
+			m_columnInfo[name] = { filename, type == "f8" };
+
+		m_isOpen = true;
+		return true;
+	}
+
+	void ColumnarCacheReader::Close()
+	{
+		UnmapColumns();
+		m_columnInfo.clear();
+		m_nEntries = 0;
+		m_isOpen = false;
+	}
+
+	void ColumnarCacheReader::UnmapColumns()
+	{
+		for(auto& column : m_active)
+			munmap(column.data, column.bytes);
+		m_active.clear();
+	}
+
+	bool ColumnarCacheReader::ActivateColumns(const std::vector<std::string>& names)
+	{
+		UnmapColumns();
+		if(!m_isOpen)
+			return false;
+
+		for(auto& name : names)
+		{
+			const EventField* field = FindProcessedEventField(name);
+			auto info = m_columnInfo.find(name);
+			if(field == nullptr || info == m_columnInfo.end())
+			{
+				EVB_WARN("Column {0} not found in columnar cache {1}.", name, m_directory);
+				UnmapColumns();
+				return false;
+			}
+
+			std::size_t bytes = m_nEntries * (info->second.isDouble ? sizeof(double) : sizeof(float));
+			if(bytes == 0)
+				continue;
+
+			int fd = open((m_directory + "/" + info->second.filename).c_str(), O_RDONLY);
+			struct stat status;
+			if(fd < 0 || fstat(fd, &status) != 0 || std::size_t(status.st_size) != bytes)
+			{
+				EVB_WARN("Column {0} in columnar cache {1} is missing or truncated.", name, m_directory);
+				if(fd >= 0)
+					close(fd);
+				UnmapColumns();
+				return false;
+			}
+
+			void* data = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if(data == MAP_FAILED)
+			{
+				UnmapColumns();
+				return false;
+			}
+			madvise(data, bytes, MADV_SEQUENTIAL);
+			m_active.push_back({ field, info->second.isDouble, data, bytes });
+		}
+		return true;
+	}
+
+	void ColumnarCacheReader::GetEntry(uint64_t entry, ProcessedEvent& event) const
+	{
+		for(auto& column : m_active)
+		{
+			if(column.isDouble)
+				GetFieldReference(event, *column.field) = static_cast<const double*>(column.data)[entry];
+			else
+				GetFieldReference(event, *column.field) = static_cast<const float*>(column.data)[entry];
+		}
+	}
+
+}
@@ -0,0 +1,88 @@
+/*
+	ColumnarCache.h
+	Binary columnar cache of analyzed (ProcessedEvent) data, written next to the analyzed ROOT file as
+	run_N.cols/. Each numeric field is stored as a flat little-endian array in its own file; a text manifest
+	lists the number of entries and the columns. Absolute times are stored as float64 (float32 can't hold
+	ns precision over a run), everything else as float32.
+
+	The reader memory maps only the requested columns, so replotting with different cuts touches only the
+	data the plots actually use and never goes through ROOT deserialization.
+*/
+#ifndef COLUMNAR_CACHE_H
+#define COLUMNAR_CACHE_H
+
+#include "ProcessedEventFields.h"
+#include <cstdio>
+
+namespace EventBuilder {
+
+	class ColumnarCacheWriter
+	{
+	public:
+		ColumnarCacheWriter();
+		~ColumnarCacheWriter();
+		bool Open(const std::string& directory);
+		void Fill(const ProcessedEvent& event);
+		void Close(); //flushes the columns and writes the manifest
+		inline bool IsOpen() const { return m_isOpen; }
+
+	private:
+		struct Column
+		{
+			const EventField* field;
+			FILE* file;
+			std::vector<char> buffer;
+		};
+
+		void FlushColumn(Column& column);
+
+		std::string m_directory;
+		std::vector<Column> m_columns;
+		uint64_t m_nEntries;
+		bool m_isOpen;
+
+		static constexpr std::size_t s_bufferSize = 1 << 20; //bytes per column before a write
+	};
+
+	class ColumnarCacheReader
+	{
+	public:
+		ColumnarCacheReader();
+		~ColumnarCacheReader();
+		bool Open(const std::string& directory);
+		void Close();
+		bool ActivateColumns(const std::vector<std::string>& names); //maps the named columns; others are left untouched in GetEntry
+		void GetEntry(uint64_t entry, ProcessedEvent& event) const;
+		inline uint64_t GetEntries() const { return m_nEntries; }
+		inline bool IsOpen() const { return m_isOpen; }
+
+		static std::string GetCacheDirectory(const std::string& rootfile);
+		static bool HasValidCache(const std::string& rootfile);
+
+	private:
+		struct ColumnInfo
+		{
+			std::string filename;
+			bool isDouble;
+		};
+
+		struct MappedColumn
+		{
+			const EventField* field;
+			bool isDouble;
+			void* data;
+			std::size_t bytes;
+		};
+
+		void UnmapColumns();
+
+		std::string m_directory;
+		std::unordered_map<std::string, ColumnInfo> m_columnInfo;
+		std::vector<MappedColumn> m_active;
+		uint64_t m_nEntries;
+		bool m_isOpen;
+	};
+
+}
+
+#endif
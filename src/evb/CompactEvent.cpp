@@ -0,0 +1,119 @@
+/*
+	CompactEvent.cpp
+	Conversion between CoincEvent and CompactEvent. See header for the encoding.
+*/
+#include "CompactEvent.h"
+#include <cmath>
+
+namespace EventBuilder {
+
+	//Hit lists addressed by index. Append only; the index is written to disk.
+	static std::vector<DetectorHit>* GetHitListPointer(CoincEvent& event, std::size_t index)
+	{
+		static constexpr std::size_t nFocalPlane = 10;
+		static constexpr std::size_t nSabre = sizeof(event.sabreArray)/sizeof(event.sabreArray[0]);
+		static constexpr std::size_t nCatrina = sizeof(event.catrinaArray)/sizeof(event.catrinaArray[0]);
+
+		FPDetector& fp = event.focalPlane;
+		std::vector<DetectorHit>* focalPlane[nFocalPlane] = {
+			&fp.delayFL, &fp.delayFR, &fp.delayBL, &fp.delayBR, &fp.anodeF, &fp.anodeB,
+			&fp.scintL, &fp.scintR, &fp.cathode, &fp.monitor
+		};
+
+		if(index < nFocalPlane)
+			return focalPlane[index];
+		index -= nFocalPlane;
+		if(index < nSabre)
+			return &event.sabreArray[index].rings;
+		index -= nSabre;
+		if(index < nSabre)
+			return &event.sabreArray[index].wedges;
+		index -= nSabre;
+		if(index < nCatrina)
+			return &event.catrinaArray[index].catr;
+		return nullptr;
+	}
+
+	std::size_t GetNumberOfHitLists()
+	{
+		static const std::size_t nLists = []()
+		{
+			CoincEvent event;
+			std::size_t n = 0;
+			while(GetHitListPointer(event, n) != nullptr)
+				n++;
+			return n;
+		}();
+		return nLists;
+	}
+
+	std::vector<DetectorHit>& GetHitList(CoincEvent& event, std::size_t index)
+	{
+		return *GetHitListPointer(event, index);
+	}
+
+	const std::vector<DetectorHit>& GetHitList(const CoincEvent& event, std::size_t index)
+	{
+		return *GetHitListPointer(const_cast<CoincEvent&>(event), index);
+	}
+
+	static inline long long GetTimePs(const DetectorHit& hit)
+	{
+		return std::llround(hit.Time*1.0e3); //DetectorHit times are ns
+	}
+
+	void EncodeCompactEvent(const CoincEvent& event, CompactEvent& compact)
+	{
+		compact.list.clear();
+		compact.channel.clear();
+		compact.energy.clear();
+		compact.energyShort.clear();
+		compact.deltaTime.clear();
+		compact.startTime = 0;
+
+		bool first = true;
+		long long previous = 0;
+		std::size_t nLists = GetNumberOfHitLists();
+		for(std::size_t i=0; i<nLists; i++)
+		{
+			for(auto& hit : GetHitList(event, i))
+			{
+				long long time = GetTimePs(hit);
+				if(first)
+				{
+					compact.startTime = time;
+					previous = time;
+					first = false;
+				}
+				compact.list.push_back(i);
+				compact.channel.push_back(hit.Ch);
+				compact.energy.push_back(hit.Long);
+				compact.energyShort.push_back(hit.Short);
+				compact.deltaTime.push_back(time - previous); //bounded by the event window, which is far below 2^31 ps
+				previous = time;
+			}
+		}
+	}
+
+	void DecodeCompactEvent(const CompactEvent& compact, CoincEvent& event)
+	{
+		std::size_t nLists = GetNumberOfHitLists();
+		for(std::size_t i=0; i<nLists; i++)
+			GetHitList(event, i).clear();
+
+		long long time = compact.startTime;
+		DetectorHit hit;
+		for(std::size_t i=0; i<compact.list.size(); i++)
+		{
+			time += compact.deltaTime[i];
+			if(compact.list[i] >= nLists)
+				continue;
+			hit.Ch = compact.channel[i];
+			hit.Long = compact.energy[i];
+			hit.Short = compact.energyShort[i];
+			hit.Time = time/1.0e3;
+			GetHitList(event, compact.list[i]).push_back(hit);
+		}
+	}
+
+}
@@ -0,0 +1,29 @@
+/*
+	CompactEvent.h
+	Conversion between CoincEvent and its compact on-disk form (CompactEvent, see DataStructs.h).
+
+	A DetectorHit holds Long, Short, and Time as doubles, but the digitizer only ever gives us 16-bit energies
+	and integer ps timestamps. The compact form keeps exactly that: uint16 energies, a uint16 global channel,
+	a uint8 list index, and event-relative integer ps times delta encoded from hit to hit (~11 bytes/hit instead
+	of 28). Decoding restores the original values; times agree to the ps.
+
+	The list index is the position in the table behind GetHitList(), which is shared by encoder and decoder. Only
+	append to that table, or older compact files will be decoded into the wrong lists.
+*/
+#ifndef COMPACT_EVENT_H
+#define COMPACT_EVENT_H
+
+#include "DataStructs.h"
+
+namespace EventBuilder {
+
+	std::size_t GetNumberOfHitLists();
+	std::vector<DetectorHit>& GetHitList(CoincEvent& event, std::size_t index);
+	const std::vector<DetectorHit>& GetHitList(const CoincEvent& event, std::size_t index);
+
+	void EncodeCompactEvent(const CoincEvent& event, CompactEvent& compact);
+	void DecodeCompactEvent(const CompactEvent& compact, CoincEvent& event);
+
+}
+
+#endif
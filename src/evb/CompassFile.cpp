@@ -1,7 +1,7 @@
 /*
     CompassFile.cpp
-    Wrapper class around a shared pointer to an ifstream. The shared pointer is used
-    to overcome limitations of ifstream, especially that it cannot be moved. This class
+    Wrapper class around a shared pointer to a file descriptor. The shared pointer keeps
+    the class copy/movable while the descriptor is only closed once. This class
     parses a binary CompassFile and extracts relevant data like board/channel numbers,
     timestamps, energy, flags, and more.
     
@@ -9,28 +9,42 @@
 */
 
 #include "CompassFile.h"
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 namespace EventBuilder {
 
+    //Unaligned-safe read of a little-endian field from the raw buffer
+    template<typename T>
+    static inline T ReadField(const char* ptr)
+    {
+        T value;
+        std::memcpy(&value, ptr, sizeof(T));
+        return value;
+    }
+
     // Default constructor initializes class members.
     CompassFile::CompassFile() :
-        m_filename(""), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_hitUsedFlag(true), m_hitsize(0), m_buffersize(0),
-        m_file(std::make_shared<std::ifstream>()), m_eofFlag(false)
+        m_filename(""), m_headroom(0), m_readOffset(0), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_parser(nullptr), m_waveDSP(nullptr), m_keepWaves(false), m_hitUsedFlag(true), m_hitsize(0), m_fixedHitSize(0), m_buffersize(0),
+        m_file(std::make_unique<FileHandle>()), m_readAhead(std::make_unique<AsyncRead>()), m_isOpen(false), m_eofFlag(false)
     {
     }
 
     // Constructor that opens a file and initializes parameters.
     CompassFile::CompassFile(const std::string& filename) :
-        m_filename(""), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_hitUsedFlag(true), m_hitsize(0), m_buffersize(0),
-        m_file(std::make_shared<std::ifstream>()), m_eofFlag(false)
+        m_filename(""), m_headroom(0), m_readOffset(0), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_parser(nullptr), m_waveDSP(nullptr), m_keepWaves(false), m_hitUsedFlag(true), m_hitsize(0), m_fixedHitSize(0), m_buffersize(0),
+        m_file(std::make_unique<FileHandle>()), m_readAhead(std::make_unique<AsyncRead>()), m_isOpen(false), m_eofFlag(false)
     {
         Open(filename);
     }
 
     // Constructor that takes a filename and buffer size.
     CompassFile::CompassFile(const std::string& filename, int bsize) :
-        m_filename(""), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_hitUsedFlag(true), m_bufsize(bsize), m_hitsize(0),
-        m_buffersize(0), m_file(std::make_shared<std::ifstream>()), m_eofFlag(false)
+        m_filename(""), m_headroom(0), m_readOffset(0), m_bufferIter(nullptr), m_bufferEnd(nullptr), m_smap(nullptr), m_parser(nullptr), m_waveDSP(nullptr), m_keepWaves(false), m_hitUsedFlag(true), m_bufsize(bsize), m_hitsize(0), m_fixedHitSize(0),
+        m_buffersize(0), m_file(std::make_unique<FileHandle>()), m_readAhead(std::make_unique<AsyncRead>()), m_isOpen(false), m_eofFlag(false)
     {
         Open(filename);
     }
@@ -41,38 +55,90 @@ namespace EventBuilder {
         Close();
     }
 
+    CompassFile::FileHandle::~FileHandle()
+    {
+        Close();
+    }
+
+    void CompassFile::FileHandle::Close()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
     // Open the specified Compass file. Reads the header and initializes parameters.
     void CompassFile::Open(const std::string& filename) 
     {
+        m_readAhead->Wait(); // A read from a previous file may still be landing in our buffers
         m_eofFlag = false;
         m_hitUsedFlag = true;
         m_filename = filename;
         m_nHits = 0;
-        m_file->open(m_filename, std::ios::binary | std::ios::in); // Open file in binary mode
-        m_file->seekg(0, std::ios_base::end); // Seek to the end of the file
-        m_size = m_file->tellg(); // Get file size
+        m_size = 0;
+        m_bufferIter = nullptr;
+        m_bufferEnd = nullptr;
+        m_headroom = 0;
+        m_readOffset = 0;
+        Buffer().swap(m_hitBuffer); // Release any buffers from a previous file
+        Buffer().swap(m_nextBuffer);
+        m_file->Close();
+        m_file->fd = ::open(m_filename.c_str(), O_RDONLY); // Open file for reading
+        m_isOpen = m_file->fd >= 0;
+        if (!m_isOpen)
+            return;
+
+        struct stat info;
+        if (::fstat(m_file->fd, &info) == 0)
+            m_size = info.st_size; // Get file size
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(m_file->fd, 0, 0, POSIX_FADV_SEQUENTIAL); // Let the kernel read ahead aggressively
+#endif
         
         if (m_size == 2) 
         {
             m_eofFlag = true; // If file size is 2, it indicates EOF
+            m_file->Close(); // Nothing to read, don't hold the descriptor
         } 
         else 
         {
-            m_file->seekg(0, std::ios_base::beg); // Seek to the beginning of the file
             ReadHeader(); // Read file header to configure hit size and other parameters
-            m_nHits = m_size / m_hitsize; // Calculate number of hits
-            m_buffersize = m_hitsize * m_bufsize; // Calculate buffer size
-            m_hitBuffer.resize(m_buffersize); // Resize the hit buffer
+            m_nHits = (m_size - 2) / m_hitsize; // Calculate number of hits (the 2 byte header is not a hit)
+            m_buffersize = m_hitsize * m_bufsize; // Buffer size in bytes; allocated at the first read
+            m_readOffset = 2; // Hits start after the header
+            if (GetDataSize() <= s_smallFileSize)
+                ReadWholeFile();
         }
     }
 
-    // Close the file stream if it is open.
+    // Close the file if it is open.
     void CompassFile::Close() 
     {
-        if (IsOpen()) 
-        {
-            m_file->close();
-        }
+        if (m_readAhead == nullptr) // Moved from; the new owner closes the file
+            return;
+        m_readAhead->Wait();
+        m_file->Close();
+        m_isOpen = false;
+    }
+
+    void CompassFile::SetBufferHits(int hits)
+    {
+        m_bufsize = std::max(hits, 1);
+        if (m_hitsize > 0)
+            m_buffersize = m_hitsize * m_bufsize;
+    }
+
+    // Small files are read in one go, so that many of them don't each hold a descriptor and a full size buffer
+    void CompassFile::ReadWholeFile()
+    {
+        m_hitBuffer.resize(GetDataSize());
+        long nread = AsyncRead::ReadFully(m_file->fd, m_hitBuffer.data(), m_hitBuffer.size(), m_readOffset);
+        m_bufferIter = m_hitBuffer.data();
+        m_bufferEnd = m_bufferIter + std::max(nread, 0L);
+        m_readOffset += std::max(nread, 0L);
+        m_file->Close();
     }
 
     // Read the header from the file to determine hit size and other properties.
@@ -84,43 +150,43 @@ namespace EventBuilder {
             return;
         }
 
-        char* header = new char[2];
-        m_file->read(header, 2); // Read the first 2 bytes for header
-        m_header = *((uint16_t*)header); // Interpret header as 16-bit value
+        char header[2] = {0, 0};
+        AsyncRead::ReadFully(m_file->fd, header, 2, 0); // Read the first 2 bytes for header
+        m_header = ReadField<uint16_t>(header); // Interpret header as 16-bit value
         m_hitsize = 16; // Default hit size is 16 bytes
 
         // Adjust hit size based on certain flags (energy, calibration, etc.)
         if (IsEnergy()) m_hitsize += 2;
         if (IsEnergyCalibrated()) m_hitsize += 8;
         if (IsEnergyShort()) m_hitsize += 2;
-        if (IsWaves())
+        if (HasWaves())
         {
-            EVB_ERROR("Waveforms are not supported by the SPS_SABRE_EventBuilder. The wave data will be skipped.");
             m_hitsize += 5;
-            char* firstHit = new char[m_hitsize]; // Allocate memory for a hit
-            m_file->read(firstHit, m_hitsize); // Read first hit data
-            firstHit += m_hitsize - 4;
-            uint32_t nsamples = *((uint32_t*) firstHit); // Get number of waveform samples
+            // Ns is stored per hit; the first hit is only used to size the buffer and estimate the hit count
+            std::vector<char> firstHit(m_hitsize);
+            long nread = AsyncRead::ReadFully(m_file->fd, firstHit.data(), m_hitsize, 2);
+            uint32_t nsamples = nread == m_hitsize ? ReadField<uint32_t>(firstHit.data() + m_hitsize - 4) : 0;
+            m_fixedHitSize = m_hitsize;
             m_hitsize += nsamples * 2; // Adjust hit size for waveform samples
-            m_file->seekg(0, std::ios_base::beg); // Seek back to beginning
-            m_file->read(header, 2); // Read header again
-            delete[] firstHit; // Cleanup memory
+            EVB_INFO("File {0} contains waveforms ({1} samples in first hit).", m_filename, nsamples);
         }
+        else
+            m_fixedHitSize = m_hitsize;
 
-        delete[] header; // Clean up header memory
+        m_parser = SelectParser(m_header); // Header is fixed for the file, so pick the decoder once
     }
 
     /*
         GetNextHit() retrieves the next hit from the file.
-        It refills the buffer if necessary, and marks the hit as unused for the next level.
+        It refills the buffer until a complete hit is available (wave hits can straddle buffers),
+        and marks the hit as unused for the next level.
         Returns true if EOF is reached, false otherwise.
     */
     bool CompassFile::GetNextHit()
     {
         if (!IsOpen()) return true;
 
-        // If buffer is empty or reached end, fetch next buffer
-        if ((m_bufferIter == nullptr || m_bufferIter == m_bufferEnd) && !IsEOF()) 
+        while (GetBufferedHitSize() == 0 && !IsEOF())
         {
             GetNextBuffer();
         }
@@ -135,60 +201,147 @@ namespace EventBuilder {
     }
 
     /*
-        GetNextBuffer() reads the next buffer from the file and sets the buffer iterators.
-        Signals EOF after the last buffer is read completely.
+        GetNextBuffer() swaps in the buffer filled by the prefetch and starts filling the other one.
+        Any unparsed bytes (a partial hit) are copied into the headroom just before the new data; if
+        they don't fit (a wave hit longer than the headroom) the headroom is grown. Signals EOF once
+        there is no more data to read; a trailing partial hit at that point is dropped.
     */
     void CompassFile::GetNextBuffer() 
     {
-        if (m_file->eof()) 
+        if (m_file->fd < 0 || (m_readOffset >= m_size && !m_readAhead->IsPending())) 
         {
-            m_eofFlag = true; // Set EOF flag when end of file is reached
+            m_eofFlag = true; // Set EOF flag when end of file is reached (or the whole file was read on Open)
             return;
         }
 
-        m_file->read(m_hitBuffer.data(), m_hitBuffer.size()); // Read next buffer of hits
-        m_bufferIter = m_hitBuffer.data(); // Set buffer iterator to the start of the buffer
-        m_bufferEnd = m_bufferIter + m_file->gcount(); // Set buffer end iterator (one past the last byte)
-    }
-
-    // Parse the next hit from the buffer and extract relevant data
-    void CompassFile::ParseNextHit() 
-    {
-        m_currentHit.board = *((uint16_t*)m_bufferIter); // Read board ID
-        m_bufferIter += 2;
-        m_currentHit.channel = *((uint16_t*)m_bufferIter); // Read channel ID
-        m_bufferIter += 2;
-        m_currentHit.timestamp = *((uint64_t*)m_bufferIter); // Read timestamp
-        m_bufferIter += 8;
+        if (m_hitBuffer.empty())
+        {
+            // No point in buffers larger than the file; headroom starts at one fixed size hit
+            size_t dataSize = std::min<size_t>(std::max(m_buffersize, m_fixedHitSize), GetDataSize());
+            m_headroom = m_hitsize;
+            m_hitBuffer.resize(m_headroom + dataSize);
+            m_nextBuffer.resize(m_headroom + dataSize);
+            StartPrefetch();
+        }
 
-        // Parse additional fields based on flags (Energy, Calibration, etc.)
-        if (IsEnergy())
+        long nread = m_readAhead->Wait();
+        if (nread < 0)
         {
-            m_currentHit.energy = *((uint16_t*)m_bufferIter); // Read energy
-            m_bufferIter += 2;
+            EVB_ERROR("Read error in file {0}; remaining hits are lost.", m_filename);
+            m_file->Close();
+            m_eofFlag = true;
+            return;
         }
-        if (IsEnergyCalibrated())
+        else if (nread == 0) // File is shorter than when it was opened
         {
-            m_currentHit.energyCalibrated = *((uint64_t*)m_bufferIter); // Read calibrated energy
-            m_bufferIter += 8;
+            m_eofFlag = true;
+            return;
         }
-        if (IsEnergyShort())
+        m_readOffset += nread;
+
+        size_t leftover = m_bufferIter == nullptr ? 0 : m_bufferEnd - m_bufferIter;
+        if (leftover > m_headroom)
         {
-            m_currentHit.energyShort = *((uint16_t*)m_bufferIter); // Read short energy
-            m_bufferIter += 2;
+            size_t headroom = leftover * 2;
+            Buffer grown(headroom + m_nextBuffer.size() - m_headroom);
+            std::memcpy(grown.data() + headroom, m_nextBuffer.data() + m_headroom, nread);
+            m_nextBuffer.swap(grown);
+            m_headroom = headroom;
         }
-        m_currentHit.flags = *((uint32_t*)m_bufferIter); // Read flags (e.g., PSD/PHA settings)
-        m_bufferIter += 4;
+        std::memcpy(m_nextBuffer.data() + m_headroom - leftover, m_bufferIter, leftover);
+
+        m_hitBuffer.swap(m_nextBuffer);
+        m_bufferIter = m_hitBuffer.data() + m_headroom - leftover; // Set buffer iterator to the start of the unparsed data
+        m_bufferEnd = m_hitBuffer.data() + m_headroom + nread; // Set buffer end iterator (one past the last byte)
+        if (m_nextBuffer.size() != m_hitBuffer.size())
+            m_nextBuffer.resize(m_hitBuffer.size()); // Spare is the old current buffer, fully parsed, so it can be reallocated
+
+        StartPrefetch();
+    }
+
+    // Queue the read of the next stretch of the file into the spare buffer
+    void CompassFile::StartPrefetch()
+    {
+        if (m_readOffset >= m_size)
+            return;
+        size_t size = std::min<uint64_t>(m_nextBuffer.size() - m_headroom, m_size - m_readOffset);
+        m_readAhead->Start(m_file->fd, m_nextBuffer.data() + m_headroom, size, m_readOffset);
+    }
+
+    // Size of the next hit in the buffer, or 0 if the buffer does not hold a complete hit
+    size_t CompassFile::GetBufferedHitSize() const
+    {
+        if (m_bufferIter == nullptr)
+            return 0;
+
+        size_t available = m_bufferEnd - m_bufferIter;
+        if (available < size_t(m_fixedHitSize))
+            return 0;
+        else if (!HasWaves())
+            return m_fixedHitSize;
+
+        size_t size = m_fixedHitSize + 2 * size_t(ReadField<uint32_t>(m_bufferIter + m_fixedHitSize - 4));
+        return available < size ? 0 : size;
+    }
+
+    /*
+        ParseHit() decodes a single hit with the layout fixed at compile time. For every non-wave
+        combination all field offsets and the stride are constants, so the decode is branch-free
+        and the compiler can merge the loads. Waves remain variable length (Ns is per hit).
+    */
+    template<bool hasEnergy, bool hasCalibrated, bool hasShort, bool hasWaves>
+    void CompassFile::ParseHit(char*& iter, CompassHit& hit)
+    {
+        constexpr int energyOffset = 12;
+        constexpr int calibratedOffset = energyOffset + (hasEnergy ? 2 : 0);
+        constexpr int shortOffset = calibratedOffset + (hasCalibrated ? 8 : 0);
+        constexpr int flagsOffset = shortOffset + (hasShort ? 2 : 0);
+        constexpr int fixedSize = flagsOffset + 4;
+
+        hit.board = ReadField<uint16_t>(iter); // Read board ID
+        hit.channel = ReadField<uint16_t>(iter + 2); // Read channel ID
+        hit.timestamp = ReadField<uint64_t>(iter + 4); // Read timestamp
+        if constexpr (hasEnergy)
+            hit.energy = ReadField<uint16_t>(iter + energyOffset);
+        if constexpr (hasCalibrated)
+            hit.energyCalibrated = ReadField<uint64_t>(iter + calibratedOffset);
+        if constexpr (hasShort)
+            hit.energyShort = ReadField<uint16_t>(iter + shortOffset);
+        hit.flags = ReadField<uint32_t>(iter + flagsOffset); // Read flags (e.g., PSD/PHA settings)
+        iter += fixedSize;
 
         // Handle waveform data (if present)
-        if (IsWaves())
+        if constexpr (hasWaves)
         {
-            m_currentHit.waveCode = *((uint8_t*)m_bufferIter); // Read wave code
-            m_bufferIter += 1;
-            m_currentHit.Ns = *((uint32_t*)m_bufferIter); // Read number of samples
-            m_bufferIter += 4;
-            m_bufferIter += 2 * m_currentHit.Ns; // Skip waveform data
+            hit.waveCode = ReadField<uint8_t>(iter); // Read wave code
+            hit.Ns = ReadField<uint32_t>(iter + 1); // Read number of samples
+            iter += 5 + 2 * hit.Ns; // Skip waveform data
         }
+    }
+
+    // Map the header flag bits onto the matching ParseHit instantiation
+    CompassFile::HitParser CompassFile::SelectParser(uint16_t header)
+    {
+        static const HitParser parsers[16] = {
+            &ParseHit<false, false, false, false>, &ParseHit<true, false, false, false>,
+            &ParseHit<false, true, false, false>,  &ParseHit<true, true, false, false>,
+            &ParseHit<false, false, true, false>,  &ParseHit<true, false, true, false>,
+            &ParseHit<false, true, true, false>,   &ParseHit<true, true, true, false>,
+            &ParseHit<false, false, false, true>,  &ParseHit<true, false, false, true>,
+            &ParseHit<false, true, false, true>,   &ParseHit<true, true, false, true>,
+            &ParseHit<false, false, true, true>,   &ParseHit<true, false, true, true>,
+            &ParseHit<false, true, true, true>,    &ParseHit<true, true, true, true>
+        };
+        return parsers[header & 0x000F];
+    }
+
+    // Parse the next hit from the buffer and extract relevant data
+    void CompassFile::ParseNextHit() 
+    {
+        m_parser(m_bufferIter, m_currentHit);
+
+        if (HasWaves() && (m_keepWaves || m_waveDSP != nullptr))
+            ProcessWaveform();
 
         // Apply channel shift if shift map is provided
         if (m_smap != nullptr) 
@@ -199,4 +352,32 @@ namespace EventBuilder {
         }
     }
 
+    /*
+        ProcessWaveform() handles the samples of the hit that was just parsed. The parser has already
+        advanced past them, so they sit directly behind the buffer iterator. Samples are only copied
+        out if they are to be kept; the DSP runs directly on the buffer.
+    */
+    void CompassFile::ProcessWaveform()
+    {
+        const char* sampleData = m_bufferIter - 2 * size_t(m_currentHit.Ns);
+        if (m_keepWaves)
+        {
+            m_currentHit.samples.resize(m_currentHit.Ns);
+            std::memcpy(m_currentHit.samples.data(), sampleData, 2 * size_t(m_currentHit.Ns));
+        }
+
+        if (m_waveDSP != nullptr)
+        {
+            if (m_keepWaves)
+                m_waveDSP->Process(m_currentHit.samples.data(), m_currentHit.Ns, m_currentHit);
+            else
+            {
+                // The raw buffer gives no alignment guarantee for uint16_t, so stage through scratch storage
+                m_waveScratch.resize(m_currentHit.Ns);
+                std::memcpy(m_waveScratch.data(), sampleData, 2 * size_t(m_currentHit.Ns));
+                m_waveDSP->Process(m_waveScratch.data(), m_currentHit.Ns, m_currentHit);
+            }
+        }
+    }
+
 }
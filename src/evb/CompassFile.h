@@ -1,10 +1,16 @@
 /*
 	CompassFile.h
-	Wrapper class around a shared pointer to an ifstream. Here the shared pointer is used
-	to overcome limitations of the ifstream class, namely that it is written such that ifstream
-	cannot be modified by move semantics. Contains all information needed to parse a single binary
-	CompassFile. Currently has a class wide defined buffer size; may want to make this user input
-	in the future.
+	Wrapper class around a file descriptor. The class is move-only: the descriptor, buffers and pending
+	read-ahead belong to exactly one object, so the descriptor is only closed once. Contains all
+	information needed to parse a single binary CompassFile. The read buffer defaults to s_defaultBufferHits hits; owners juggling many files can size
+	it per file with SetBufferHits() before the first read (see CompassRun::SizeReadBuffers). The buffer is
+	only allocated on the first read, and never larger than the file itself. Files of at most
+	s_smallFileSize bytes are read whole on Open and their descriptor closed straight away.
+
+	Reading is double buffered: while the current buffer is parsed, the next one is filled in the
+	background by an AsyncRead (io_uring or I/O threads), so disk latency overlaps with the merge
+	instead of stalling it. Each buffer keeps some headroom in front, where the partial hit left at
+	the end of the previous buffer is copied so that it joins up with the new data.
 
 	Written by G.W. McCann Oct. 2020
 */
@@ -13,6 +19,8 @@
 
 #include "CompassHit.h"
 #include "ShiftMap.h"
+#include "WaveformDSP.h"
+#include "AsyncRead.h"
 #include <memory>
 
 namespace EventBuilder {
@@ -25,52 +33,95 @@ namespace EventBuilder {
 		CompassFile(const std::string& filename);
 		CompassFile(const std::string& filename, int bsize);
 		~CompassFile();
+		CompassFile(const CompassFile&) = delete;
+		CompassFile& operator=(const CompassFile&) = delete;
+		CompassFile(CompassFile&&) = default; //buffers keep their storage, so a pending read still lands in them
+		CompassFile& operator=(CompassFile&&) = delete; //would free our buffers before waiting on our read
 		void Open(const std::string& filename);
 		void Close();
 		bool GetNextHit();
 	
-		inline bool IsOpen() const { return m_file->is_open(); };
-		inline CompassHit GetCurrentHit() const { return m_currentHit; }
+		inline bool IsOpen() const { return m_isOpen; }; //descriptor may already be closed for small files, which are held in memory
+		inline const CompassHit& GetCurrentHit() const { return m_currentHit; }
 		inline std::string GetName() const { return  m_filename; }
 		inline bool CheckHitHasBeenUsed() const { return m_hitUsedFlag; } //query to find out if we've used the current hit
 		inline void SetHitHasBeenUsed() { m_hitUsedFlag = true; } //flip the flag to indicate the current hit has been used
 		inline bool IsEOF() const { return m_eofFlag; } //see if we've read all available data
 		inline void AttachShiftMap(ShiftMap* map) { m_smap = map; }
+		inline void AttachWaveDSP(WaveformDSP* dsp) { m_waveDSP = dsp; }
+		inline void SetKeepWaveforms(bool keep) { m_keepWaves = keep; }
+		inline bool HasWaves() const { return (m_header & CoMPASSHeaders::Waves) != 0; }
 		inline unsigned int GetSize() const { return m_size; }
-		inline unsigned int GetNumberOfHits() const { return m_nHits; }
+		inline unsigned int GetNumberOfHits() const { return m_nHits; } //estimate only for wave files (Ns can vary per hit)
+		inline std::size_t GetDataSize() const { return m_size > 2 ? m_size - 2 : 0; } //bytes of hit data (file less header)
+		inline int GetHitSize() const { return m_hitsize; }
+		inline bool IsHeldInMemory() const { return m_isOpen && m_file->fd < 0; }
+		void SetBufferHits(int hits); //takes effect at the first read
+
+		static constexpr int s_defaultBufferHits = 200000;
+		static constexpr std::size_t s_smallFileSize = 64*1024; //bytes
+		static constexpr int s_buffersPerFile = 2; //current + prefetch, for memory budgeting
 	
 	
 	private:
+		//Parser signature; advances the iterator past the hit it decodes
+		using HitParser = void (*)(char*&, CompassHit&);
+
 		void ReadHeader();
 		void ParseNextHit();
 		void GetNextBuffer();
+		void StartPrefetch();
+		void ReadWholeFile();
+		size_t GetBufferedHitSize() const;
+		void ProcessWaveform();
+
+		//Compile-time specialized hit decoder, one instantiation per header flag combination
+		template<bool hasEnergy, bool hasCalibrated, bool hasShort, bool hasWaves>
+		static void ParseHit(char*& iter, CompassHit& hit);
+		static HitParser SelectParser(uint16_t header);
 
 		inline bool IsEnergy() { return (m_header & CoMPASSHeaders::Energy) != 0; }
 		inline bool IsEnergyCalibrated() { return (m_header & CoMPASSHeaders::EnergyCalibrated) != 0; }
 		inline bool IsEnergyShort() { return (m_header & CoMPASSHeaders::EnergyShort) != 0; }
-		inline bool IsWaves() { return (m_header & CoMPASSHeaders::Waves) != 0; }
 	
 		using Buffer = std::vector<char>;
 	
-		using FilePointer = std::shared_ptr<std::ifstream>; //to make this class copy/movable
+		//Raw descriptor, for pread/io_uring
+		struct FileHandle
+		{
+			~FileHandle();
+			void Close();
+			int fd = -1;
+		};
+		using FilePointer = std::unique_ptr<FileHandle>; //null once moved from
 	
 		std::string m_filename;
 		Buffer m_hitBuffer;
+		Buffer m_nextBuffer; //being filled by m_readAhead
+		std::size_t m_headroom; //bytes in front of the data in both buffers, room for a partial hit
+		uint64_t m_readOffset; //file offset of the next byte to be read
 		char* m_bufferIter;
 		char* m_bufferEnd;
 		ShiftMap* m_smap; //NOT owned by CompassFile. DO NOT delete
+		HitParser m_parser; //Chosen once per file in ReadHeader
+		WaveformDSP* m_waveDSP; //NOT owned by CompassFile. DO NOT delete
+		bool m_keepWaves;
+		std::vector<uint16_t> m_waveScratch; //aligned copy of the samples for DSP when they are not kept
 	
 		bool m_hitUsedFlag;
-		int m_bufsize = 200000; //size of the buffer in hits
-		int m_hitsize; //size of a CompassHit in bytes (without alignment padding)
+		int m_bufsize = s_defaultBufferHits; //size of the buffer in hits
+		int m_hitsize; //size of a CompassHit in bytes (without alignment padding); for waves, uses the first hit's Ns
+		int m_fixedHitSize; //size of the hit up to and including the wave Ns field
 		uint16_t m_header;
 		int m_buffersize;
 	
 		CompassHit m_currentHit;
 		FilePointer m_file;
+		std::unique_ptr<AsyncRead> m_readAhead; //declared after the buffers so a pending read is waited on before they go; null once moved from
+		bool m_isOpen;
 		bool m_eofFlag;
 		unsigned int m_size; //size of the file in bytes
-		unsigned int m_nHits; //number of hits in the file (m_size/24)
+		unsigned int m_nHits; //number of hits in the file ((m_size-2)/m_hitsize)
 
 		enum CoMPASSHeaders
 		{
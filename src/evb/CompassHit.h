@@ -14,6 +14,10 @@ namespace EventBuilder {
 		uint32_t flags = 0;
 		uint8_t waveCode = 0;
 		uint32_t Ns = 0;
+		std::vector<uint16_t> samples; //only filled when waveforms are kept
+		float waveBaseline = 0.0f; //WaveformDSP results, only filled when DSP is enabled
+		float waveEnergy = 0.0f;
+		float waveTime = -1.0f; //ns from first sample, -1 if no CFD crossing
 	};
 
 }
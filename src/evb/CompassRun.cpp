@@ -13,17 +13,32 @@
 #include "SlowSort.h"
 #include "FastSort.h"
 #include "SFPAnalyzer.h"
+#include "ParallelAnalyzer.h"
 #include "FlagHandler.h"
+#include "RateMonitor.h"
+#include "ColumnarCache.h"
+#include "CompactEvent.h"
+#include "TreeWriter.h"
+#include "SFPPlotter.h"
+#include "ThreadTopology.h"
 #include "EVBApp.h"
 
 namespace EventBuilder {
 
 	// Constructor that initializes CompassRun with the given parameters and workspace
 	CompassRun::CompassRun(const EVBParameters& params, const std::shared_ptr<EVBWorkspace>& workspace) :
-		m_params(params), m_workspace(workspace)
+		m_params(params), m_workspace(workspace), m_reorder(m_params.reorderHorizon > 0.0 ? uint64_t(m_params.reorderHorizon) : 0, m_params.reorderCapacity),
+		m_scaler_flag(false)
 	{
 		// Set the time shift map using the provided file
 		m_smap.SetFile(m_params.timeShiftFile);
+
+		if(m_params.waveDSP)
+			m_waveDSP = std::make_unique<WaveformDSP>(m_params.waveDSPParams);
+
+		//Converters are made on the thread that runs them, before any file buffers exist, so pinning here keeps those buffers node local.
+		//m_affinityGuard gives the thread its old mask back when the converter is destroyed.
+		ThreadTopology::GetInstance().PinBuildThread(m_params.affinityParams);
 	}
 	
 	// Destructor
@@ -36,6 +51,8 @@ namespace EventBuilder {
 	void CompassRun::SetScalers() 
 	{
 		// Open the scaler file
+		m_scaler_flag = false;
+		m_scalerRateTasks.clear();
 		std::ifstream input(m_params.scalerFile);
 		if(!input.is_open()) 
 			return; // Return if the file cannot be opened
@@ -69,6 +86,7 @@ namespace EventBuilder {
 
 		m_datafiles.clear(); // Clear previous data files
 		m_datafiles.reserve(files.size()); // Preallocate memory for data files
+		m_reorder.Reset();
 		bool scalerd;
 		m_totalHits = 0; // Reset the total number of hits (events)
 	
@@ -96,6 +114,8 @@ namespace EventBuilder {
 			// Otherwise, treat it as a data file
 			m_datafiles.emplace_back(entry);
 			m_datafiles[m_datafiles.size()-1].AttachShiftMap(&m_smap); // Attach the shift map to the data file
+			m_datafiles[m_datafiles.size()-1].AttachWaveDSP(m_waveDSP.get()); // nullptr if DSP is off
+			m_datafiles[m_datafiles.size()-1].SetKeepWaveforms(m_params.keepWaveforms);
 
 			// Check if the file is successfully opened; if not, return false
 			if(!m_datafiles[m_datafiles.size() - 1].IsOpen()) 
@@ -105,31 +125,123 @@ namespace EventBuilder {
 			m_totalHits += m_datafiles[m_datafiles.size()-1].GetNumberOfHits();
 		}
 	
+		SizeReadBuffers();
 		return true; // Successfully loaded files
 	}
+
+	/*
+		SizeReadBuffers() splits the ReadBufferBudget(MB) over the open data files (two buffers each, see CompassFile). Files are drained at a rate set by
+		their share of the hits, so buffers are made proportional to file size; every file then refills at about the same
+		pace and no single small buffer stalls the merge. Files that fit entirely are given exactly their size, small
+		files are already held in memory by CompassFile, and no file gets less than s_minReadBufferHits.
+	*/
+	void CompassRun::SizeReadBuffers()
+	{
+		const std::size_t budget = std::size_t(std::max(m_params.readBufferBudget, 0.0)*1024.0*1024.0);
+		const std::size_t bufferBudget = budget/CompassFile::s_buffersPerFile; //each file holds a current and a prefetch buffer
+
+		std::size_t demand = 0;
+		std::size_t nBuffered = 0;
+		for(auto& file : m_datafiles)
+		{
+			if(file.IsEOF() || file.IsHeldInMemory())
+				continue;
+			demand += std::min<std::size_t>(file.GetDataSize(), std::size_t(CompassFile::s_defaultBufferHits)*file.GetHitSize());
+			++nBuffered;
+		}
+		if(nBuffered == 0)
+			return;
+
+		double scale = demand > bufferBudget ? double(bufferBudget)/demand : 1.0;
+		std::size_t total = 0;
+		for(auto& file : m_datafiles)
+		{
+			if(file.IsEOF() || file.IsHeldInMemory())
+				continue;
+			std::size_t want = std::min<std::size_t>(file.GetDataSize(), std::size_t(CompassFile::s_defaultBufferHits)*file.GetHitSize());
+			int hits = std::max<int>(want*scale/file.GetHitSize(), s_minReadBufferHits);
+			file.SetBufferHits(hits);
+			total += CompassFile::s_buffersPerFile*std::min<std::size_t>(std::size_t(hits)*file.GetHitSize(), file.GetDataSize());
+		}
+
+		EVB_INFO("Read buffers: {0:.1f} MB over {1} files (budget {2:.1f} MB), {3} small or empty files held in memory.", total/(1024.0*1024.0), nBuffered,
+				 budget/(1024.0*1024.0), m_datafiles.size() - nBuffered);
+	}
 	
 	/*
-		ReadScalerData() counts the number of hits in a scaler file and updates the corresponding scaler map.
+		ReadScalerData() sets the scaler count for a scaler file. Scaler files are fixed size hits, so the count comes
+		straight from the file size and header; only wave files (per-hit sample counts) have to be parsed. If requested,
+		time-binned rates are counted on a separate thread so that they overlap with the data merge.
 	*/
 	void CompassRun::ReadScalerData(const std::string& filename) 
 	{
 		if(!m_scaler_flag) 
 			return; // Return if scaler data is not enabled
 	
-		Long64_t count = 0; // Initialize the hit counter
-		CompassFile file(filename); // Open the scaler file
+		CompassFile file(filename, 1024); // Small buffer; we normally only need the header
+		if(!file.IsOpen())
+		{
+			EVB_WARN("Unable to open scaler file {0} at CompassRun::ReadScalerData()", filename);
+			return;
+		}
 		auto& this_param = m_scaler_map[file.GetName()]; // Get the corresponding parameter for this file
-		
-		// Loop through the hits in the file and count them
-		while(true) 
+
+		Long64_t count = 0;
+		if(!file.HasWaves())
+			count = file.GetNumberOfHits();
+		else
 		{
-			file.GetNextHit(); // Get the next hit from the file
-			if(file.IsEOF()) // End of file reached
-				break;
-			count++; // Increment the hit counter
+			while(!file.GetNextHit())
+				count++;
 		}
 		// Set the final count in the scaler map
 		this_param.SetVal(count);
+
+		if(m_params.scalerRateBinWidth > 0.0)
+		{
+			m_scalerRateTasks.emplace_back(this_param.GetName(),
+										   std::async(std::launch::async, &CompassRun::CountScalerRate, filename, m_params.scalerRateBinWidth));
+		}
+	}
+
+	/*
+		CountScalerRate() counts the hits in a scaler file in time bins of binWidth seconds, measured from the start of the run.
+		Runs on a worker thread, so it only touches its own CompassFile.
+	*/
+	std::vector<uint64_t> CompassRun::CountScalerRate(const std::string& filename, double binWidth)
+	{
+		std::vector<uint64_t> counts;
+		CompassFile file(filename);
+		const double binWidthPS = binWidth * 1.0e12;
+		while(!file.GetNextHit())
+		{
+			std::size_t bin = file.GetCurrentHit().timestamp / binWidthPS;
+			if(bin >= counts.size())
+				counts.resize(bin + 1, 0);
+			counts[bin]++;
+		}
+		return counts;
+	}
+
+	/*
+		WriteScalers() writes the scaler totals, and the binned rates (in Hz) if they were requested, to the current directory.
+	*/
+	void CompassRun::WriteScalers()
+	{
+		for(auto& entry : m_scaler_map)
+			entry.second.Write();
+
+		for(auto& task : m_scalerRateTasks)
+		{
+			std::vector<uint64_t> counts = task.second.get();
+			std::string name = task.first + "_rate";
+			int nbins = std::max<int>(counts.size(), 1);
+			TH1D histo(name.c_str(), (name + ";time (s);rate (Hz)").c_str(), nbins, 0.0, nbins * m_params.scalerRateBinWidth);
+			for(std::size_t i=0; i<counts.size(); i++)
+				histo.SetBinContent(i + 1, counts[i] / m_params.scalerRateBinWidth);
+			histo.Write();
+		}
+		m_scalerRateTasks.clear();
 	}
 	
 	/*
@@ -178,10 +290,116 @@ namespace EventBuilder {
 		return true; // Successfully retrieved a hit
 	}
 	
+	/*
+		SetBuildMode() switches the coincidizer to triggered building if requested. Falls back to the fixed
+		window if the trigger channel can't be found in the channel map.
+	*/
+	void CompassRun::SetBuildMode(SlowSort& coincidizer)
+	{
+		if(m_params.eventBuildMode == "Fixed")
+			return;
+		else if(m_params.eventBuildMode != "Triggered")
+		{
+			EVB_WARN("Unknown EventBuildMode {0}, using Fixed.", m_params.eventBuildMode);
+			return;
+		}
+
+		if(coincidizer.SetTriggerMode(m_params.triggerChannel, m_params.triggerPreWindow, m_params.triggerPostWindow))
+		{
+			EVB_INFO("Building events on trigger {0} with window [-{1}, +{2}] ps.", m_params.triggerChannel, m_params.triggerPreWindow,
+					 m_params.triggerPostWindow);
+		}
+		else
+			EVB_ERROR("Trigger channel {0} not found in channel map {1}, using Fixed build mode.", m_params.triggerChannel, m_params.channelMapFile);
+	}
+
+	/*
+		WriteSlowSortStats() writes the coincidence statistics to the current output file. Hits dropped
+		because an event exceeded the hit buffer capacity, and triggers dropped because too many were pending,
+		are reported and saved as parameters.
+	*/
+	void CompassRun::WriteSlowSortStats(SlowSort& coincidizer)
+	{
+		coincidizer.GetEventStats()->Write();
+
+		TParameter<Long64_t> overflow("slowsort_overflow", coincidizer.GetOverflowCount());
+		TParameter<Long64_t> outOfOrder("slowsort_out_of_order", coincidizer.GetOutOfOrderCount());
+		TParameter<Long64_t> triggerOverflow("slowsort_trigger_overflow", coincidizer.GetTriggerOverflowCount());
+		TParameter<Long64_t> lateDropped("slowsort_late_dropped", coincidizer.GetLateDropCount());
+		overflow.Write();
+		outOfOrder.Write();
+		triggerOverflow.Write();
+		lateDropped.Write();
+		if(coincidizer.GetOverflowCount() > 0)
+		{
+			EVB_WARN("SlowSort dropped {0} hits from windows exceeding the hit capacity ({1}). Consider raising SlowSortHitCapacity.",
+					 coincidizer.GetOverflowCount(), coincidizer.GetHitCapacity());
+		}
+		if(coincidizer.GetTriggerOverflowCount() > 0)
+		{
+			EVB_WARN("SlowSort dropped {0} triggers while the pending trigger buffer was full ({1}). Consider raising SlowSortHitCapacity.",
+					 coincidizer.GetTriggerOverflowCount(), coincidizer.GetHitCapacity());
+		}
+		if(coincidizer.GetLateDropCount() > 0)
+		{
+			EVB_WARN("SlowSort dropped {0} hits that arrived too late for any pending trigger. Consider raising ReorderHorizon.",
+					 coincidizer.GetLateDropCount());
+		}
+	}
+
+	/*
+		GetOrderedHit() is the merge plus the reorder stage. With no reorder horizon it is just GetHitsFromFiles().
+		Otherwise merged hits are pushed to the reorder buffer until it can release one; once the files are
+		exhausted the buffer is drained. The released hit is left in m_hit.
+	*/
+	bool CompassRun::GetOrderedHit()
+	{
+		if(!m_reorder.IsEnabled())
+			return GetHitsFromFiles();
+
+		while(!m_reorder.Pop(m_hit))
+		{
+			if(!GetHitsFromFiles())
+			{
+				m_reorder.Flush();
+				return m_reorder.Pop(m_hit);
+			}
+			m_reorder.Push(m_hit);
+		}
+		return true;
+	}
+
+	void CompassRun::WriteReorderStats()
+	{
+		if(!m_reorder.IsEnabled())
+			return;
+
+		TParameter<Long64_t> late("reorder_late", m_reorder.GetLateCount());
+		TParameter<Long64_t> reordered("reorder_recovered", m_reorder.GetReorderedCount());
+		late.Write();
+		reordered.Write();
+		if(m_reorder.GetLateCount() > 0)
+		{
+			EVB_WARN("{0} hits arrived later than the reorder horizon ({1} ps) and were dropped. Consider raising ReorderHorizon(ps).",
+					 m_reorder.GetLateCount(), m_reorder.GetHorizon());
+		}
+	}
+
 	// Further methods (Convert2RawRoot, Convert2SortedRoot, etc.) would follow a similar pattern, 
 	// processing data, sorting events, and writing to ROOT files.
 
 
+	void CompassRun::SendToSinks(const ProcessedEvent& event)
+	{
+		if(m_sinks.plotter != nullptr)
+			m_sinks.plotter->Fill(event);
+		if(m_sinks.mergeWriter != nullptr)
+		{
+			*m_sinks.mergeEvent = event;
+			m_sinks.mergeWriter->Fill();
+		}
+	}
+
 	void CompassRun::Convert2RawRoot(const std::string& name) {
 		TFile* output = TFile::Open(name.c_str(), "RECREATE");
 		TTree* outtree = new TTree("Data", "Data");
@@ -205,10 +423,27 @@ namespace EventBuilder {
 			EVB_ERROR("Unable to find binary files at CompassRun::Convert(), exiting!");
 			return;
 		}
+
+		//Waveform branches are only written when the data actually has waves
+		bool hasWaves = false;
+		for(auto& file : m_datafiles)
+			hasWaves |= file.HasWaves();
+		if(hasWaves && m_params.keepWaveforms)
+			outtree->Branch("Samples", &m_hit.samples);
+		if(hasWaves && m_waveDSP)
+		{
+			outtree->Branch("WaveBaseline", &m_hit.waveBaseline);
+			outtree->Branch("WaveEnergy", &m_hit.waveEnergy);
+			outtree->Branch("WaveTime", &m_hit.waveTime);
+		}
 	
 		unsigned int count = 0, flush = m_totalHits*m_progressFraction, flush_count = 0;
 	
 		startIndex = 0; //Reset the startIndex
+		FlagHandler flagger;
+		DetectorRegistry registry(m_params.channelMapFile); //only to size the rate tables
+		RateMonitor monitor(m_params.rateMonitorBinWidth, registry.GetMaxChannel() + 1);
+		TreeWriter writer(outtree);
 		if(flush == 0) 
 			flush = 1;
 		while(true) 
@@ -221,15 +456,19 @@ namespace EventBuilder {
 				m_progressCallback(flush_count*flush, m_totalHits);
 			}
 	
-			if(!GetHitsFromFiles()) 
+			if(!GetOrderedHit()) 
 				break;
-			outtree->Fill();
+			flagger.CheckFlag(m_hit.board, m_hit.channel, m_hit.flags);
+			monitor.AddHit(m_hit);
+			writer.Fill();
 		}
 	
 		output->cd();
-		outtree->Write(outtree->GetName(), TObject::kOverwrite);
-		for(auto& entry : m_scaler_map)
-			entry.second.Write();
+		writer.Write();
+		WriteScalers();
+		WriteReorderStats();
+		flagger.WriteHistogram();
+		monitor.Write();
 	
 		output->Close();
 	}
@@ -240,7 +479,11 @@ namespace EventBuilder {
 		TTree* outtree = new TTree("SortTree", "SortTree");
 	
 		CoincEvent event;
-		outtree->Branch("event", &event);
+		CompactEvent compact;
+		if(m_params.compactBuiltFiles)
+			outtree->Branch("compactEvent", &compact);
+		else
+			outtree->Branch("event", &event);
 	
 		if(!m_smap.IsValid()) 
 		{
@@ -258,7 +501,12 @@ namespace EventBuilder {
 		unsigned int count = 0, flush = m_totalHits*m_progressFraction, flush_count = 0;
 	
 		startIndex = 0;
-		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile);
+		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile, m_params.slowSortHitCapacity);
+		SetBuildMode(coincidizer);
+		FlagHandler flagger;
+		RateMonitor monitor(m_params.rateMonitorBinWidth, coincidizer.GetRegistry().GetMaxChannel() + 1);
+		TreeWriter writer(outtree);
+
 		bool killFlag = false;
 		if(flush == 0) 
 			flush = 1;
@@ -272,29 +520,39 @@ namespace EventBuilder {
 				m_progressCallback(flush_count*flush, m_totalHits);
 			}
 	
-			if(!GetHitsFromFiles()) 
+			if(!GetOrderedHit()) 
 			{
 				coincidizer.FlushHitsToEvent();
 				killFlag = true;
 			} 
 			else
+			{
+				flagger.CheckFlag(m_hit.board, m_hit.channel, m_hit.flags);
+				monitor.AddHit(m_hit);
 				coincidizer.AddHitToEvent(m_hit);
+			}
 
-			if(coincidizer.IsEventReady()) 
+			while(coincidizer.IsEventReady()) 
 			{
 				event = coincidizer.GetEvent();
-				outtree->Fill();
-				if(killFlag)
-					break;
+				monitor.AddEvent(coincidizer.GetLastEventTime(), coincidizer.GetLastEventMultiplicity());
+				if(m_params.compactBuiltFiles)
+					EncodeCompactEvent(event, compact);
+				writer.Fill();
 			}
+
+			if(killFlag)
+				break;
 		}
 	
 		output->cd();
-		outtree->Write(outtree->GetName(), TObject::kOverwrite);
-		for(auto& entry : m_scaler_map)
-			entry.second.Write();
+		writer.Write();
+		WriteScalers();
+		WriteReorderStats();
+		flagger.WriteHistogram();
+		monitor.Write();
 	
-		coincidizer.GetEventStats()->Write();
+		WriteSlowSortStats(coincidizer);
 		output->Close();
 	}
 	
@@ -304,7 +562,11 @@ namespace EventBuilder {
 		TTree* outtree = new TTree("SortTree", "SortTree");
 	
 		CoincEvent event;
-		outtree->Branch("event", &event);
+		CompactEvent compact;
+		if(m_params.compactBuiltFiles)
+			outtree->Branch("compactEvent", &compact);
+		else
+			outtree->Branch("event", &event);
 	
 		if(!m_smap.IsValid()) 
 		{
@@ -322,12 +584,13 @@ namespace EventBuilder {
 		unsigned int count = 0, flush = m_totalHits*m_progressFraction, flush_count = 0;
 	
 		startIndex = 0;
-		CoincEvent this_event;
-		std::vector<CoincEvent> fast_events;
-		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile);
+		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile, m_params.slowSortHitCapacity);
+		SetBuildMode(coincidizer);
 		FastSort speedyCoincidizer(m_params.fastCoincidenceWindowSABRE, m_params.fastCoincidenceWindowIonCh);
 	
 		FlagHandler flagger;
+		RateMonitor monitor(m_params.rateMonitorBinWidth, coincidizer.GetRegistry().GetMaxChannel() + 1);
+		TreeWriter writer(outtree);
 	
 		bool killFlag = false;
 		if(flush == 0) 
@@ -342,7 +605,7 @@ namespace EventBuilder {
 				m_progressCallback(flush_count*flush, m_totalHits);
 			}
 			
-			if(!GetHitsFromFiles()) 
+			if(!GetOrderedHit()) 
 			{
 				coincidizer.FlushHitsToEvent();
 				killFlag = true;
@@ -350,42 +613,63 @@ namespace EventBuilder {
 			else 
 			{
 				flagger.CheckFlag(m_hit.board, m_hit.channel, m_hit.flags);
+				monitor.AddHit(m_hit);
 				coincidizer.AddHitToEvent(m_hit);
 			}
 	
-			if(coincidizer.IsEventReady()) 
+			while(coincidizer.IsEventReady()) 
 			{
-				this_event = coincidizer.GetEvent();
+				const HitEvent& this_event = coincidizer.GetHitEvent();
+				monitor.AddEvent(coincidizer.GetLastEventTime(), coincidizer.GetLastEventMultiplicity());
 	
-				fast_events = speedyCoincidizer.GetFastEvents(this_event);
+				FastEventRange fast_events = speedyCoincidizer.GetFastEvents(this_event);
 				for(auto& entry : fast_events) 
 				{
-					event = entry;
-					outtree->Fill();
+					ConvertToCoincEvent(entry, event);
+					if(m_params.compactBuiltFiles)
+						EncodeCompactEvent(event, compact);
+					writer.Fill();
 				}
-				if(killFlag) 
-					break;
 			}
+
+			if(killFlag)
+				break;
 		}
 	
 		output->cd();
-		outtree->Write(outtree->GetName(), TObject::kOverwrite);
-		for(auto& entry : m_scaler_map)
-			entry.second.Write();
+		writer.Write();
+		WriteScalers();
+		WriteReorderStats();
+		flagger.WriteHistogram();
+		monitor.Write();
 		
-		coincidizer.GetEventStats()->Write();
+		WriteSlowSortStats(coincidizer);
 		output->Close();
 	}
 	
 	
+	//run_N.root -> run_N_stats.root, which the run catalogue does not take for an analyzed run
+	std::string CompassRun::GetStatsFileName(const std::string& name)
+	{
+		std::string::size_type extension = name.rfind(".root");
+		if(extension == std::string::npos)
+			return name + "_stats";
+		return name.substr(0, extension) + "_stats.root";
+	}
+
 	void CompassRun::Convert2SlowAnalyzedRoot(const std::string& name) 
 	{
 	
-		TFile* output = TFile::Open(name.c_str(), "RECREATE");
-		TTree* outtree = new TTree("SPSTree", "SPSTree");
+		//Without the tree only run statistics are written; keep them apart so an existing analyzed tree survives
+		TFile* output = TFile::Open(m_params.writeAnalyzedTree ? name.c_str() : GetStatsFileName(name).c_str(), "RECREATE");
+		TTree* outtree = nullptr;
 	
 		ProcessedEvent pevent;
-		outtree->Branch("event", &pevent);
+		if(m_params.writeAnalyzedTree)
+		{
+			outtree = new TTree("SPSTree", "SPSTree");
+			outtree->Branch("event", &pevent);
+		}
 	
 		if(!m_smap.IsValid()) 
 		{
@@ -403,9 +687,10 @@ namespace EventBuilder {
 		unsigned int count = 0, flush = m_totalHits*m_progressFraction, flush_count = 0;
 	
 		startIndex = 0;
-		CoincEvent this_event;
-		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile);
+		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile, m_params.slowSortHitCapacity);
+		SetBuildMode(coincidizer);
 		SFPAnalyzer analyzer(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.beamEnergy, m_params.spsAngle, m_params.BField,m_params.nudge,m_params.Q);
+		analyzer.SetPSDThreshold(m_params.catrinaPSDThreshold);
 	
 		std::vector<TParameter<Double_t>> parvec;
 		parvec.reserve(11); // went from 9 to 11 parameters -JCE June 2024
@@ -422,6 +707,30 @@ namespace EventBuilder {
 		parvec.emplace_back("Q", m_params.Q); // -JCE June 2024
 		
 	
+		ColumnarCacheWriter cache;
+		if(m_params.writeColumnarCache && outtree != nullptr)
+			cache.Open(ColumnarCacheReader::GetCacheDirectory(name));
+
+		FlagHandler flagger;
+		RateMonitor monitor(m_params.rateMonitorBinWidth, coincidizer.GetRegistry().GetMaxChannel() + 1);
+		std::unique_ptr<TreeWriter> writer;
+		if(outtree != nullptr)
+			writer = std::make_unique<TreeWriter>(outtree);
+
+		//Analyzed events are written from this thread in build order, whether analyzed here or on the workers
+		auto output_event = [&](const ProcessedEvent& result)
+		{
+			pevent = result;
+			if(writer)
+				writer->Fill();
+			cache.Fill(pevent);
+			SendToSinks(pevent);
+		};
+		std::unique_ptr<ParallelAnalyzer> parallel;
+		int nAnalysisThreads = ParallelAnalyzer::ResolveThreads(m_params.analysisThreads);
+		if(nAnalysisThreads > 1)
+			parallel = std::make_unique<ParallelAnalyzer>(analyzer, nAnalysisThreads, m_params.affinityParams);
+
 		bool killFlag = false;
 		if(flush == 0) 
 			flush = 1;
@@ -435,48 +744,70 @@ namespace EventBuilder {
 				m_progressCallback(flush_count*flush, m_totalHits);
 			}
 	
-			if(!GetHitsFromFiles()) 
+			if(!GetOrderedHit()) 
 			{
 				coincidizer.FlushHitsToEvent();
 				killFlag = true;
 			} 
 			else 
 			{
+				flagger.CheckFlag(m_hit.board, m_hit.channel, m_hit.flags);
+				monitor.AddHit(m_hit);
 				coincidizer.AddHitToEvent(m_hit);
 			}
 	
-			if(coincidizer.IsEventReady()) 
+			while(coincidizer.IsEventReady()) 
 			{
-				this_event = coincidizer.GetEvent();
-				pevent = analyzer.GetProcessedEvent(this_event);
-				outtree->Fill();
-				if(killFlag) 
-					break;
+				const HitEvent& this_event = coincidizer.GetHitEvent();
+				monitor.AddEvent(coincidizer.GetLastEventTime(), coincidizer.GetLastEventMultiplicity());
+				if(parallel)
+					parallel->Submit(this_event, output_event);
+				else
+					output_event(analyzer.GetProcessedEvent(this_event));
 			}
+
+			if(killFlag)
+				break;
+		}
+
+		if(parallel)
+		{
+			parallel->Finish(output_event);
+			output->cd(); //merged histograms follow the serial ones into the output file
+			parallel->MergeHistograms(analyzer);
 		}
 	
 		output->cd();
-		outtree->Write(outtree->GetName(), TObject::kOverwrite);
-		for(auto& entry : m_scaler_map)
-			entry.second.Write();
+		if(writer)
+			writer->Write();
+		WriteScalers();
+		WriteReorderStats();
+		flagger.WriteHistogram();
+		monitor.Write();
 	
 		for(auto& entry : parvec)
 			entry.Write();
 	
-		coincidizer.GetEventStats()->Write();
+		WriteSlowSortStats(coincidizer);
 		analyzer.GetHashTable()->Write();
 		analyzer.ClearHashTable();
 		output->Close();
+		cache.Close(); //after the ROOT file, so that the cache is never older than it
 	}
 	
 	void CompassRun::Convert2FastAnalyzedRoot(const std::string& name) 
 	{
 	
-		TFile* output = TFile::Open(name.c_str(), "RECREATE");
-		TTree* outtree = new TTree("SPSTree", "SPSTree");
+		//Without the tree only run statistics are written; keep them apart so an existing analyzed tree survives
+		TFile* output = TFile::Open(m_params.writeAnalyzedTree ? name.c_str() : GetStatsFileName(name).c_str(), "RECREATE");
+		TTree* outtree = nullptr;
 	
 		ProcessedEvent pevent;
-		outtree->Branch("event", &pevent);
+		if(m_params.writeAnalyzedTree)
+		{
+			outtree = new TTree("SPSTree", "SPSTree");
+			outtree->Branch("event", &pevent);
+		}
 	
 		if(!m_smap.IsValid()) 
 		{
@@ -494,11 +825,11 @@ namespace EventBuilder {
 		unsigned int count = 0, flush = m_totalHits*m_progressFraction, flush_count = 0;
 	
 		startIndex = 0;
-		CoincEvent this_event;
-		std::vector<CoincEvent> fast_events;
-		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile);
+		SlowSort coincidizer(m_params.slowCoincidenceWindow, m_params.channelMapFile, m_params.slowSortHitCapacity);
+		SetBuildMode(coincidizer);
 		FastSort speedyCoincidizer(m_params.fastCoincidenceWindowSABRE, m_params.fastCoincidenceWindowIonCh);
 		SFPAnalyzer analyzer(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.beamEnergy, m_params.spsAngle, m_params.BField, m_params.nudge, m_params.Q);
+		analyzer.SetPSDThreshold(m_params.catrinaPSDThreshold);
 	
 		std::vector<TParameter<Double_t>> parvec;
 		parvec.reserve(11); // went from 9 to 11 parameters -JCE June 2024
@@ -515,7 +846,29 @@ namespace EventBuilder {
 		parvec.emplace_back("Q", m_params.Q); // -JCE June 2024
 		
 	
+		ColumnarCacheWriter cache;
+		if(m_params.writeColumnarCache && outtree != nullptr)
+			cache.Open(ColumnarCacheReader::GetCacheDirectory(name));
+
 		FlagHandler flagger;
+		RateMonitor monitor(m_params.rateMonitorBinWidth, coincidizer.GetRegistry().GetMaxChannel() + 1);
+		std::unique_ptr<TreeWriter> writer;
+		if(outtree != nullptr)
+			writer = std::make_unique<TreeWriter>(outtree);
+
+		//Analyzed events are written from this thread in build order, whether analyzed here or on the workers
+		auto output_event = [&](const ProcessedEvent& result)
+		{
+			pevent = result;
+			if(writer)
+				writer->Fill();
+			cache.Fill(pevent);
+			SendToSinks(pevent);
+		};
+		std::unique_ptr<ParallelAnalyzer> parallel;
+		int nAnalysisThreads = ParallelAnalyzer::ResolveThreads(m_params.analysisThreads);
+		if(nAnalysisThreads > 1)
+			parallel = std::make_unique<ParallelAnalyzer>(analyzer, nAnalysisThreads, m_params.affinityParams);
 	
 		bool killFlag = false;
 		if(flush == 0) 
@@ -530,7 +883,7 @@ namespace EventBuilder {
 				m_progressCallback(flush_count*flush, m_totalHits);
 			}
 	
-			if(!GetHitsFromFiles()) 
+			if(!GetOrderedHit()) 
 			{
 				coincidizer.FlushHitsToEvent();
 				killFlag = true;
@@ -538,35 +891,51 @@ namespace EventBuilder {
 			else 
 			{
 				flagger.CheckFlag(m_hit.board, m_hit.channel, m_hit.flags);
+				monitor.AddHit(m_hit);
 				coincidizer.AddHitToEvent(m_hit);
 			}
 	
-			if(coincidizer.IsEventReady()) 
+			while(coincidizer.IsEventReady()) 
 			{
-				this_event = coincidizer.GetEvent();
+				const HitEvent& this_event = coincidizer.GetHitEvent();
+				monitor.AddEvent(coincidizer.GetLastEventTime(), coincidizer.GetLastEventMultiplicity());
 	
-				fast_events = speedyCoincidizer.GetFastEvents(this_event);
+				FastEventRange fast_events = speedyCoincidizer.GetFastEvents(this_event);
 				for(auto& entry : fast_events) 
 				{
-					pevent = analyzer.GetProcessedEvent(entry);
-					outtree->Fill();
+					if(parallel)
+						parallel->Submit(entry, output_event);
+					else
+						output_event(analyzer.GetProcessedEvent(entry));
 				}
-				if(killFlag) 
-					break;
 			}
+
+			if(killFlag)
+				break;
+		}
+
+		if(parallel)
+		{
+			parallel->Finish(output_event);
+			output->cd(); //merged histograms follow the serial ones into the output file
+			parallel->MergeHistograms(analyzer);
 		}
 	
 		output->cd();
-		outtree->Write(outtree->GetName(), TObject::kOverwrite);
-		for(auto& entry : m_scaler_map) 
-			entry.second.Write();
+		if(writer)
+			writer->Write();
+		WriteScalers();
+		WriteReorderStats();
+		flagger.WriteHistogram();
+		monitor.Write();
 	
 		for(auto& entry : parvec)
 			entry.Write();
 	
-		coincidizer.GetEventStats()->Write();
+		WriteSlowSortStats(coincidizer);
 		analyzer.GetHashTable()->Write();
 		analyzer.ClearHashTable();
 		output->Close();
+		cache.Close(); //after the ROOT file, so that the cache is never older than it
 	}
 }
\ No newline at end of file
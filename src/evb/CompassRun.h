@@ -16,10 +16,25 @@
 #include "ProgressCallback.h"
 #include "EVBWorkspace.h"
 #include "EVBParameters.h"
+#include "WaveformDSP.h"
+#include "HitReorderBuffer.h"
 #include <TParameter.h>
+#include <future>
 
 namespace EventBuilder {
 	
+	class SlowSort;
+	class SFPPlotter;
+	class TreeWriter;
+
+	//Optional consumers of analyzed events, used when operations are chained (see EVBApp::RunOperationChain)
+	struct AnalyzedEventSinks
+	{
+		SFPPlotter* plotter = nullptr; //histograms filled straight from the analyzer
+		TreeWriter* mergeWriter = nullptr; //merged tree filled as runs are converted
+		ProcessedEvent* mergeEvent = nullptr; //branch address of the merged tree
+	};
+
 	class CompassRun 
 	{
 	
@@ -32,23 +47,37 @@ namespace EventBuilder {
 		void Convert2FastSortedRoot(const std::string& name);
 		void Convert2SlowAnalyzedRoot(const std::string& name);
 		void Convert2FastAnalyzedRoot(const std::string& name);
+		static std::string GetStatsFileName(const std::string& name); //where the analyzed conversions write with WriteAnalyzedTree off
 	
 		inline void SetProgressCallbackFunc(const ProgressCallbackFunc& function) { m_progressCallback = function; }
 		inline void SetProgressFraction(double frac) { m_progressFraction = frac; }
+		inline void SetAnalyzedEventSinks(const AnalyzedEventSinks& sinks) { m_sinks = sinks; }
 	
 	private:
 		bool GetBinaryFiles();
+		void SizeReadBuffers();
 		bool GetHitsFromFiles();
+		bool GetOrderedHit();
+		void WriteReorderStats();
 		void SetScalers();
 		void ReadScalerData(const std::string& filename);
+		void WriteScalers();
+		static std::vector<uint64_t> CountScalerRate(const std::string& filename, double binWidth);
+		void SetBuildMode(SlowSort& coincidizer);
+		void WriteSlowSortStats(SlowSort& coincidizer);
+		void SendToSinks(const ProcessedEvent& event);
 
 		EVBParameters m_params;
 		std::shared_ptr<EVBWorkspace> m_workspace;
+		ThreadAffinityGuard m_affinityGuard; //the conversion thread's mask from before PinBuildThread(), restored with the run
 	
 		std::vector<CompassFile> m_datafiles;
 		unsigned int startIndex; //this is the file we start looking at; increases as we finish files.
 		ShiftMap m_smap;
+		HitReorderBuffer m_reorder;
+		std::unique_ptr<WaveformDSP> m_waveDSP; //only allocated if DSP was requested
 		std::unordered_map<std::string, TParameter<Long64_t>> m_scaler_map; //maps scaler files to the TParameter to be saved
+		std::vector<std::pair<std::string, std::future<std::vector<uint64_t>>>> m_scalerRateTasks; //scaler name, binned counts
 	
 		//Raw hit
 		CompassHit m_hit;
@@ -60,8 +89,12 @@ namespace EventBuilder {
 		//Scaler switch
 		bool m_scaler_flag;
 	
+		AnalyzedEventSinks m_sinks;
+
 		ProgressCallbackFunc m_progressCallback;
 		double m_progressFraction;
+
+		static constexpr int s_minReadBufferHits = 1024;
 	};
 
 }
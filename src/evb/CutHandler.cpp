@@ -1,20 +1,19 @@
 #include "CutHandler.h"
+#include <algorithm>
 
 namespace EventBuilder {
 	
 
 	CutHandler::CutHandler() :
 		validFlag(false)
-	 {
-		InitVariableMap();
-	 }
+	{
+	}
 	
 
 	CutHandler::CutHandler(const std::string& filename) :
 		validFlag(false)
 	{
 		SetCuts(filename);
-		InitVariableMap();
 	}
 	
 
@@ -40,6 +39,7 @@ namespace EventBuilder {
 	
 		cut_array.clear();
 		file_array.clear();
+		field_array.clear();
 
 	
 		while(cutlist>>name) 
@@ -67,46 +67,52 @@ namespace EventBuilder {
 			validFlag = true;
 		else
 			validFlag = false;
+
+		ResolveFields();
 	}
 	
 	/*
-		ADD MORE VARIABLES HERE!
+		Cut variables may be any numeric ProcessedEvent field (see ProcessedEventFields). Names are looked up
+		once here, so IsInside reads the values straight out of the event without copying it.
 	*/
-	void CutHandler::InitVariableMap() 
+	void CutHandler::ResolveFields()
 	{
-		varmap["x1"] = &m_event.x1;
-		varmap["x2"] = &m_event.x2;
-		varmap["xavg"] = &m_event.xavg;
-		varmap["scintLeft"] = &m_event.scintLeft;
-		varmap["anodeBack"]  = &m_event.anodeBack;
-		varmap["cathode"] = &m_event.cathode;
-
-		// Chris added these
-		varmap["theta"] = &m_event.theta;
-		varmap["anodeFront"] = &m_event.anodeFront;
+		field_array.clear();
+		for(auto cut : cut_array)
+		{
+			const EventField* x = FindProcessedEventField(cut->GetVarX());
+			const EventField* y = FindProcessedEventField(cut->GetVarY());
+			if(x == nullptr || y == nullptr)
+			{
+				EVB_WARN("Unmapped variable names at CutHandler::ResolveFields() (x:{0}, y:{1})! Cuts ignored.", cut->GetVarX(), cut->GetVarY());
+				field_array.clear();
+				validFlag = false;
+				return;
+			}
+			field_array.push_back({ x, y });
+		}
 	}
 	
-	bool CutHandler::IsInside(const ProcessedEvent* eaddress) 
+	std::vector<std::string> CutHandler::GetRequiredVariables()
 	{
-		m_event = *eaddress;
-		std::string x, y;
-		for(unsigned int i=0; i<cut_array.size(); i++) 
+		std::vector<std::string> variables;
+		for(auto cut : cut_array)
 		{
-			TCutG* cut = cut_array[i];
-			x = cut->GetVarX();
-			y = cut->GetVarY();
-			auto xentry = varmap.find(x);
-			auto yentry = varmap.find(y);
-			
-			if(xentry == varmap.end() || yentry == varmap.end()) 
+			for(const char* var : { cut->GetVarX(), cut->GetVarY() })
 			{
-				EVB_WARN("Unmapped variable names at CutHandler::IsInside() (x:{0}, y:{1})! Cut not applied.", xentry->first, yentry->first);
-				return false;
+				if(std::find(variables.begin(), variables.end(), var) == variables.end())
+					variables.emplace_back(var);
 			}
+		}
+		return variables;
+	}
 	
-			if(!cut->IsInside(*(xentry->second), *(yentry->second)))
+	bool CutHandler::IsInside(const ProcessedEvent* eaddress) 
+	{
+		for(unsigned int i=0; i<field_array.size(); i++) 
+		{
+			if(!cut_array[i]->IsInside(GetFieldValue(*eaddress, *field_array[i].x), GetFieldValue(*eaddress, *field_array[i].y)))
 				return false;
-			
 		}
 	
 		return true;
@@ -2,6 +2,7 @@
 #define CUTHANDLER_H
 
 #include "../spsdict/DataStructs.h"
+#include "ProcessedEventFields.h"
 
 namespace EventBuilder {
 	
@@ -14,15 +15,21 @@ namespace EventBuilder {
 		bool IsValid() { return validFlag; }
 		bool IsInside(const ProcessedEvent* eaddress);
 		std::vector<TCutG*> GetCuts() { return cut_array; }
+		std::vector<std::string> GetRequiredVariables(); //ProcessedEvent fields referenced by the cuts
 	
 	private:
-		void InitVariableMap();
+		struct CutFields
+		{
+			const EventField* x;
+			const EventField* y;
+		};
+
+		void ResolveFields();
 	
 		std::vector<TCutG*> cut_array;
 		std::vector<TFile*> file_array;
-		std::unordered_map<std::string, double*> varmap;
+		std::vector<CutFields> field_array; //parallel to cut_array, resolved once when the cuts are set
 		bool validFlag;
-		ProcessedEvent m_event;	
 	};
 
 }
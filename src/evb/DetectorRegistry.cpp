@@ -0,0 +1,132 @@
+/*
+	DetectorRegistry.cpp
+	Builds the detector and channel tables from a channel map file. See header.
+*/
+#include "DetectorRegistry.h"
+#include <sstream>
+
+namespace EventBuilder {
+
+	DetectorRegistry::DetectorRegistry() :
+		m_isValid(false)
+	{
+	}
+
+	DetectorRegistry::DetectorRegistry(const std::string& mapfile) :
+		m_isValid(false)
+	{
+		Build(mapfile);
+	}
+
+	DetectorRegistry::~DetectorRegistry() {}
+
+	/*
+		Channel map file format: two header lines, then global_channel detector_id type part per line. The part is
+		the local channel for array detectors, and the part name for the focal plane.
+	*/
+	bool DetectorRegistry::Build(const std::string& mapfile)
+	{
+		m_detectors.clear();
+		m_channels.clear();
+		m_names.clear();
+		m_isValid = false;
+
+		std::ifstream input(mapfile);
+		if(!input.is_open())
+			return m_isValid;
+
+		std::string junk, line, type, part;
+		int gchan, id;
+		std::getline(input, junk);
+		std::getline(input, junk);
+		while(std::getline(input, line))
+		{
+			std::stringstream stream(line);
+			if(!(stream >> gchan >> id >> type >> part))
+				continue;
+			if(gchan < 0)
+			{
+				EVB_WARN("At DetectorRegistry::Build() -- Negative global channel {0} in {1}, skipping.", gchan, mapfile);
+				continue;
+			}
+
+			if(gchan >= int(m_channels.size()))
+				m_channels.resize(gchan + 1);
+			ChannelEntry& entry = m_channels[gchan];
+			entry.isMapped = true;
+			entry.detector = -1;
+			entry.localChannel = -1;
+			if(type == "UNUSED")
+				continue;
+
+			entry.detector = Register(type, id, part);
+			if(type == "FOCALPLANE")
+				entry.localChannel = id;
+			else if(!part.empty() && part.find_first_not_of("0123456789") == std::string::npos)
+				entry.localChannel = std::stoi(part);
+		}
+
+		m_isValid = true;
+		return m_isValid;
+	}
+
+	int DetectorRegistry::Register(const std::string& type, int id, const std::string& part)
+	{
+		std::string name = type == "FOCALPLANE" ? type + "_" + part : type + "_" + std::to_string(id);
+		auto iter = m_names.find(name);
+		if(iter != m_names.end())
+			return iter->second;
+
+		DetectorInfo info;
+		info.name = name;
+		info.type = type;
+		info.id = id;
+		info.legacyList = GetLegacyList(type, id, part);
+		info.sortByEnergy = type == "SABRERING" || type == "SABREWEDGE";
+		if(info.legacyList == -1)
+			EVB_WARN("Detector {0} (type {1}) has no CoincEvent hit list; its hits will not be written to any output tree.", name, type);
+
+		int detector = m_detectors.size();
+		m_detectors.push_back(info);
+		m_names[name] = detector;
+		return detector;
+	}
+
+	int DetectorRegistry::FindDetector(const std::string& name) const
+	{
+		auto iter = m_names.find(name);
+		return iter == m_names.end() ? -1 : iter->second;
+	}
+
+	std::vector<int> DetectorRegistry::GetChannels(int detector) const
+	{
+		std::vector<int> channels;
+		for(std::size_t i=0; i<m_channels.size(); i++)
+			if(m_channels[i].detector == detector)
+				channels.push_back(i);
+		return channels;
+	}
+
+	//Position of the detector's list in the CompactEvent GetHitList table
+	int DetectorRegistry::GetLegacyList(const std::string& type, int id, const std::string& part)
+	{
+		static const std::string focalPlaneParts[s_focalPlaneHitLists] = {
+			"DELAYFL", "DELAYFR", "DELAYBL", "DELAYBR", "ANODEFRONT", "ANODEBACK", "SCINTLEFT", "SCINTRIGHT", "CATHODE", "MONITOR"
+		};
+
+		if(type == "FOCALPLANE")
+		{
+			for(int i=0; i<s_focalPlaneHitLists; i++)
+				if(part == focalPlaneParts[i])
+					return i;
+		}
+		else if(type == "SABRERING" && id >= 0 && id < s_sabreDetectors)
+			return s_focalPlaneHitLists + id;
+		else if(type == "SABREWEDGE" && id >= 0 && id < s_sabreDetectors)
+			return s_focalPlaneHitLists + s_sabreDetectors + id;
+		else if(type == "CATRINA" && id >= 0 && id < s_catrinaDetectors)
+			return s_focalPlaneHitLists + 2*s_sabreDetectors + id;
+		return -1;
+	}
+
+}
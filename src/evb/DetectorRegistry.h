@@ -0,0 +1,69 @@
+/*
+	DetectorRegistry.h
+	Data-driven map from global channels to detectors, used in event building. Every distinct
+	(type, id) pair in the channel map becomes a detector with a dense ID; focal plane channels all share one id,
+	so for them the part name distinguishes detectors instead. Detector names are TYPE_ID or FOCALPLANE_PART,
+	ex. SABRERING_0 or FOCALPLANE_SCINTLEFT. Channels of type UNUSED are known but not assigned to a detector.
+
+	Global channel lookups are a plain array index. Detectors that have a place in CoincEvent record the index of
+	that hit list (see CompactEvent.h). Any other type is still grouped in BuiltEvent but is not written out, so a
+	new array also needs a CoincEvent list; such detectors are warned about when the map is read.
+*/
+#ifndef DETECTOR_REGISTRY_H
+#define DETECTOR_REGISTRY_H
+
+namespace EventBuilder {
+
+	struct DetectorInfo
+	{
+		std::string name;
+		std::string type; //channel map type identifier, ex. SABRERING
+		int id = -1; //channel map detector id
+		int legacyList = -1; //CoincEvent hit list filled by this detector (GetHitList index), -1 if none
+		bool sortByEnergy = false; //order hits by descending energy, as done for SABRE
+	};
+
+	class DetectorRegistry
+	{
+	public:
+		DetectorRegistry();
+		DetectorRegistry(const std::string& mapfile);
+		~DetectorRegistry();
+
+		bool Build(const std::string& mapfile);
+		inline bool IsValid() const { return m_isValid; }
+
+		inline std::size_t GetNumberOfDetectors() const { return m_detectors.size(); }
+		inline const DetectorInfo& GetDetector(int detector) const { return m_detectors[detector]; }
+		inline int GetMaxChannel() const { return int(m_channels.size()) - 1; }
+		inline bool IsMapped(int gchan) const { return gchan >= 0 && gchan < int(m_channels.size()) && m_channels[gchan].isMapped; }
+		inline int GetDetectorID(int gchan) const { return gchan >= 0 && gchan < int(m_channels.size()) ? m_channels[gchan].detector : -1; }
+		inline int GetLocalChannel(int gchan) const { return gchan >= 0 && gchan < int(m_channels.size()) ? m_channels[gchan].localChannel : -1; }
+
+		int FindDetector(const std::string& name) const; //-1 if not found
+		std::vector<int> GetChannels(int detector) const; //global channels of a detector
+
+		static constexpr int s_focalPlaneHitLists = 10; //focal plane lists at the front of the GetHitList table
+		static constexpr int s_sabreDetectors = 5;
+		static constexpr int s_catrinaDetectors = 7;
+
+	private:
+		struct ChannelEntry
+		{
+			int detector = -1;
+			int localChannel = -1;
+			bool isMapped = false;
+		};
+
+		int Register(const std::string& type, int id, const std::string& part);
+		static int GetLegacyList(const std::string& type, int id, const std::string& part);
+
+		std::vector<DetectorInfo> m_detectors;
+		std::vector<ChannelEntry> m_channels; //indexed by global channel
+		std::unordered_map<std::string, int> m_names;
+		bool m_isValid;
+	};
+
+}
+
+#endif
@@ -9,12 +9,51 @@
 	Modified by J.C. Esparza June 2024
 */
 #include <cstdlib>
+#include <algorithm>
 #include "EVBApp.h"
 #include "CompassRun.h"
 #include "SFPPlotter.h"
+#include "ReactionScan.h"
+#include "Reanalyzer.h"
+#include "BuiltFileReader.h"
+#include "SFPAnalyzer.h"
+#include "TreeWriter.h"
+#include "ThreadTopology.h"
 #include "yaml-cpp/yaml.h"
 
 namespace EventBuilder {
+
+	//Scan axes are given as [min, max, steps]
+	static void ReadScanAxis(const YAML::Node& node, ScanAxis& axis)
+	{
+		if(!node)
+			return;
+		if(!node.IsSequence() || node.size() != 3)
+		{
+			EVB_WARN("Scan axis must be given as [min, max, steps]; axis ignored.");
+			return;
+		}
+		axis.min = node[0].as<double>();
+		axis.max = node[1].as<double>();
+		axis.steps = node[2].as<int>();
+	}
+
+	static void WriteScanAxis(YAML::Emitter& yamlStream, const std::string& key, const ScanAxis& axis)
+	{
+		yamlStream << YAML::Key << key << YAML::Value << YAML::Flow << YAML::BeginSeq << axis.min << axis.max << axis.steps << YAML::EndSeq;
+	}
+	
+	//Record the NUMA layout of this machine next to the pinning keys, as a guide for BuildNode/WorkerCores
+	static void WriteTopologyComment(YAML::Emitter& yamlStream)
+	{
+		ThreadTopology& topology = ThreadTopology::GetInstance();
+		std::string layout = "NUMA nodes on this machine: " + std::to_string(topology.GetNumberOfNodes());
+		for(std::size_t i=0; i<topology.GetNumberOfNodes(); i++)
+		{
+			layout += " | node " + std::to_string(topology.GetNodeID(i)) + ": cores " + ThreadTopology::FormatCpuList(topology.GetNodeCores(i));
+		}
+		yamlStream << YAML::Comment(layout);
+	}
 	
 	// Constructor for printing progess bar
 	EVBApp::EVBApp() :
@@ -43,6 +82,7 @@ namespace EventBuilder {
 		}
 
 		m_params = params;
+		TreeWriter::EnableCompressionThreads(m_params.writerThreads);
 	}
 
 	// Read in the configuration (user generated input) file
@@ -83,8 +123,107 @@ namespace EventBuilder {
 		m_params.Q = data["Q(MeV)"].as<double>(); // -JCE ??? why couldn't this be a double when I had (MeV) after Q?
 		m_params.runMin = data["MinRun"].as<int>();
 		m_params.runMax = data["MaxRun"].as<int>();
+
+		// optional keys; older configs remain valid
+		if(data["SlowSortHitCapacity"])
+		{
+			int capacity = data["SlowSortHitCapacity"].as<int>();
+			if(capacity > 0)
+				m_params.slowSortHitCapacity = capacity;
+			else
+				EVB_WARN("Invalid SlowSortHitCapacity {0}, using {1}.", capacity, m_params.slowSortHitCapacity);
+		}
+		if(data["ReadBufferBudget(MB)"])
+			m_params.readBufferBudget = data["ReadBufferBudget(MB)"].as<double>();
+		if(data["RateMonitorBinWidth(s)"])
+			m_params.rateMonitorBinWidth = data["RateMonitorBinWidth(s)"].as<double>();
+		if(data["AnalysisThreads"])
+			m_params.analysisThreads = data["AnalysisThreads"].as<int>();
+		if(data["WriterThreads"])
+			m_params.writerThreads = data["WriterThreads"].as<int>();
+		if(data["PinThreads"])
+			m_params.affinityParams.pinThreads = data["PinThreads"].as<bool>();
+		if(data["BuildNode"])
+			m_params.affinityParams.buildNode = data["BuildNode"].as<int>();
+		if(data["WorkerCores"])
+			m_params.affinityParams.workerCores = data["WorkerCores"].as<std::vector<int>>();
+		if(data["CompactBuiltFiles"])
+			m_params.compactBuiltFiles = data["CompactBuiltFiles"].as<bool>();
+		if(data["WriteColumnarCache"])
+			m_params.writeColumnarCache = data["WriteColumnarCache"].as<bool>();
+		if(data["WriteAnalyzedTree"])
+			m_params.writeAnalyzedTree = data["WriteAnalyzedTree"].as<bool>();
+		if(data["ScalerRateBinWidth(s)"])
+			m_params.scalerRateBinWidth = data["ScalerRateBinWidth(s)"].as<double>();
+		if(data["ReorderHorizon(ps)"])
+			m_params.reorderHorizon = data["ReorderHorizon(ps)"].as<double>();
+		if(data["ReorderCapacity"])
+			m_params.reorderCapacity = std::max(data["ReorderCapacity"].as<int>(), 1);
+		if(data["CatrinaPSDThreshold"])
+			m_params.catrinaPSDThreshold = data["CatrinaPSDThreshold"].as<double>();
+		if(data["EventBuildMode"])
+			m_params.eventBuildMode = data["EventBuildMode"].as<std::string>();
+		if(data["TriggerChannel"])
+			m_params.triggerChannel = data["TriggerChannel"].as<std::string>();
+		if(data["TriggerPreWindow(ps)"])
+			m_params.triggerPreWindow = data["TriggerPreWindow(ps)"].as<double>();
+		if(data["TriggerPostWindow(ps)"])
+			m_params.triggerPostWindow = data["TriggerPostWindow(ps)"].as<double>();
+		if(data["KeepWaveforms"])
+			m_params.keepWaveforms = data["KeepWaveforms"].as<bool>();
+		if(data["WaveDSP"])
+			m_params.waveDSP = data["WaveDSP"].as<bool>();
+		if(data["WaveBaselineSamples"])
+			m_params.waveDSPParams.baselineSamples = data["WaveBaselineSamples"].as<int>();
+		if(data["WaveTrapRise"])
+			m_params.waveDSPParams.trapRise = data["WaveTrapRise"].as<int>();
+		if(data["WaveTrapFlatTop"])
+			m_params.waveDSPParams.trapFlat = data["WaveTrapFlatTop"].as<int>();
+		if(data["WaveCFDFraction"])
+			m_params.waveDSPParams.cfdFraction = data["WaveCFDFraction"].as<double>();
+		if(data["WaveCFDDelay"])
+			m_params.waveDSPParams.cfdDelay = data["WaveCFDDelay"].as<int>();
+		if(data["WaveSamplePeriod(ns)"])
+			m_params.waveDSPParams.samplePeriod = data["WaveSamplePeriod(ns)"].as<double>();
+		if(data["WavePolarity"])
+			m_params.waveDSPParams.polarity = data["WavePolarity"].as<int>();
+		if(data["WaveReplaceEnergy"])
+			m_params.waveDSPParams.replaceEnergy = data["WaveReplaceEnergy"].as<bool>();
+		if(m_params.waveDSP)
+		{
+			const WaveDSPParameters& wave = m_params.waveDSPParams;
+			if(wave.baselineSamples < 1 || wave.trapRise < 1 || wave.trapFlat < 0 || wave.cfdDelay < 1)
+			{
+				EVB_ERROR("Read of EVB config failed, WaveBaselineSamples, WaveTrapRise and WaveCFDDelay must be at least 1 and WaveTrapFlatTop at least 0!");
+				return false;
+			}
+			if(wave.cfdFraction <= 0.0 || wave.cfdFraction > 1.0 || wave.samplePeriod <= 0.0)
+			{
+				EVB_ERROR("Read of EVB config failed, WaveCFDFraction must be in (0, 1] and WaveSamplePeriod(ns) greater than 0!");
+				return false;
+			}
+		}
+		ReadScanAxis(data["ScanBeamEnergy(MeV)"], m_params.scanParams.beamEnergy);
+		ReadScanAxis(data["ScanTheta(deg)"], m_params.scanParams.angle);
+		ReadScanAxis(data["ScanBfield(kG)"], m_params.scanParams.bfield);
+		ReadScanAxis(data["ScanQ(MeV)"], m_params.scanParams.Q);
+		ReadScanAxis(data["TuneNudgeRange"], m_params.tuneParams.nudge);
+		if(data["TuneXavgWindow(mm)"])
+		{
+			auto window = data["TuneXavgWindow(mm)"];
+			if(window.IsSequence() && window.size() == 2)
+			{
+				m_params.tuneParams.xavgMin = window[0].as<double>();
+				m_params.tuneParams.xavgMax = window[1].as<double>();
+			}
+			else
+				EVB_WARN("TuneXavgWindow(mm) must be given as [min, max]; window ignored.");
+		}
+		if(data["TuneSampleEvents"])
+			m_params.tuneParams.sampleEvents = data["TuneSampleEvents"].as<long>();
 	
 		EVB_INFO("Successfully loaded EVB config.");
+		TreeWriter::EnableCompressionThreads(m_params.writerThreads);
 	
 		m_workspace.reset(new EVBWorkspace(m_params.workspaceDir));
 		if(!m_workspace->IsValid())
@@ -130,6 +269,44 @@ namespace EventBuilder {
 		yamlStream << YAML::Key << "Q(MeV)" << YAML::Value << m_params.Q; // -JCE
 		yamlStream << YAML::Key << "MinRun" << YAML::Value << m_params.runMin;
 		yamlStream << YAML::Key << "MaxRun" << YAML::Value << m_params.runMax;
+		yamlStream << YAML::Key << "SlowSortHitCapacity" << YAML::Value << m_params.slowSortHitCapacity;
+		yamlStream << YAML::Key << "ReadBufferBudget(MB)" << YAML::Value << m_params.readBufferBudget;
+		yamlStream << YAML::Key << "RateMonitorBinWidth(s)" << YAML::Value << m_params.rateMonitorBinWidth;
+		yamlStream << YAML::Key << "AnalysisThreads" << YAML::Value << m_params.analysisThreads;
+		yamlStream << YAML::Key << "WriterThreads" << YAML::Value << m_params.writerThreads;
+		yamlStream << YAML::Key << "PinThreads" << YAML::Value << m_params.affinityParams.pinThreads;
+		yamlStream << YAML::Key << "BuildNode" << YAML::Value << m_params.affinityParams.buildNode;
+		yamlStream << YAML::Key << "WorkerCores" << YAML::Value << YAML::Flow << m_params.affinityParams.workerCores;
+		WriteTopologyComment(yamlStream);
+		yamlStream << YAML::Key << "CompactBuiltFiles" << YAML::Value << m_params.compactBuiltFiles;
+		yamlStream << YAML::Key << "WriteColumnarCache" << YAML::Value << m_params.writeColumnarCache;
+		yamlStream << YAML::Key << "WriteAnalyzedTree" << YAML::Value << m_params.writeAnalyzedTree;
+		yamlStream << YAML::Key << "ScalerRateBinWidth(s)" << YAML::Value << m_params.scalerRateBinWidth;
+		yamlStream << YAML::Key << "ReorderHorizon(ps)" << YAML::Value << m_params.reorderHorizon;
+		yamlStream << YAML::Key << "ReorderCapacity" << YAML::Value << m_params.reorderCapacity;
+		yamlStream << YAML::Key << "CatrinaPSDThreshold" << YAML::Value << m_params.catrinaPSDThreshold;
+		yamlStream << YAML::Key << "EventBuildMode" << YAML::Value << m_params.eventBuildMode;
+		yamlStream << YAML::Key << "TriggerChannel" << YAML::Value << m_params.triggerChannel;
+		yamlStream << YAML::Key << "TriggerPreWindow(ps)" << YAML::Value << m_params.triggerPreWindow;
+		yamlStream << YAML::Key << "TriggerPostWindow(ps)" << YAML::Value << m_params.triggerPostWindow;
+		yamlStream << YAML::Key << "KeepWaveforms" << YAML::Value << m_params.keepWaveforms;
+		yamlStream << YAML::Key << "WaveDSP" << YAML::Value << m_params.waveDSP;
+		yamlStream << YAML::Key << "WaveBaselineSamples" << YAML::Value << m_params.waveDSPParams.baselineSamples;
+		yamlStream << YAML::Key << "WaveTrapRise" << YAML::Value << m_params.waveDSPParams.trapRise;
+		yamlStream << YAML::Key << "WaveTrapFlatTop" << YAML::Value << m_params.waveDSPParams.trapFlat;
+		yamlStream << YAML::Key << "WaveCFDFraction" << YAML::Value << m_params.waveDSPParams.cfdFraction;
+		yamlStream << YAML::Key << "WaveCFDDelay" << YAML::Value << m_params.waveDSPParams.cfdDelay;
+		yamlStream << YAML::Key << "WaveSamplePeriod(ns)" << YAML::Value << m_params.waveDSPParams.samplePeriod;
+		yamlStream << YAML::Key << "WavePolarity" << YAML::Value << m_params.waveDSPParams.polarity;
+		yamlStream << YAML::Key << "WaveReplaceEnergy" << YAML::Value << m_params.waveDSPParams.replaceEnergy;
+		WriteScanAxis(yamlStream, "ScanBeamEnergy(MeV)", m_params.scanParams.beamEnergy);
+		WriteScanAxis(yamlStream, "ScanTheta(deg)", m_params.scanParams.angle);
+		WriteScanAxis(yamlStream, "ScanBfield(kG)", m_params.scanParams.bfield);
+		WriteScanAxis(yamlStream, "ScanQ(MeV)", m_params.scanParams.Q);
+		WriteScanAxis(yamlStream, "TuneNudgeRange", m_params.tuneParams.nudge);
+		yamlStream << YAML::Key << "TuneXavgWindow(mm)" << YAML::Value << YAML::Flow << YAML::BeginSeq << m_params.tuneParams.xavgMin
+				   << m_params.tuneParams.xavgMax << YAML::EndSeq;
+		yamlStream << YAML::Key << "TuneSampleEvents" << YAML::Value << m_params.tuneParams.sampleEvents;
 		yamlStream << YAML::EndMap;
 
 		output << yamlStream.c_str();
@@ -168,6 +345,148 @@ namespace EventBuilder {
 		}
 	}
 	
+	// Re-run the analysis over existing built files with the current kinematic parameters
+	void EVBApp::ReanalyzeBuiltFiles()
+	{
+		if(m_workspace == nullptr || !m_workspace->IsValid())
+		{
+			EVB_ERROR("Unable to preform event building request due to bad workspace.");
+			return;
+		}
+
+		std::string analyze_dir = m_workspace->GetAnalyzedDir();
+		EVB_INFO("Reanalyzing event built ROOT files over run range [{0}, {1}]", m_params.runMin, m_params.runMax);
+
+		Reanalyzer analyzer(m_params);
+		analyzer.SetProgressCallbackFunc(m_progressCallback);
+		analyzer.SetProgressFraction(m_progressFraction);
+
+		std::string sortfile, anafile;
+		int count = 0;
+		for(int i=m_params.runMin; i<=m_params.runMax; i++)
+		{
+			sortfile = m_workspace->GetRunFile(RunStage::Built, i);
+			anafile = analyze_dir + "run_" + std::to_string(i) + ".root";
+			if(sortfile.empty())
+				continue;
+			EVB_INFO("Reanalyzing file {0} into {1}...", sortfile, anafile);
+			if(analyzer.Run(sortfile, anafile))
+				++count;
+		}
+
+		if(count != 0)
+			EVB_INFO("Reanalysis complete.");
+		else
+			EVB_WARN("Nothing reanalyzed, no built files found in the range [{0}, {1}]", m_params.runMin, m_params.runMax);
+	}
+
+	// Find the nudge giving the narrowest xavg peak, using a sample of the built events
+	void EVBApp::TuneNudge()
+	{
+		if(m_workspace == nullptr || !m_workspace->IsValid())
+		{
+			EVB_ERROR("Unable to preform nudge tuning due to bad workspace.");
+			return;
+		}
+
+		const NudgeTuneParameters& params = m_params.tuneParams;
+		if(params.xavgMax <= params.xavgMin)
+		{
+			EVB_ERROR("Nudge tuning needs TuneXavgWindow(mm) set to a window around a single xavg peak.");
+			return;
+		}
+		NudgeTuner tuner(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.beamEnergy,
+						 m_params.spsAngle, m_params.BField, m_params.Q);
+		if(!tuner.IsValid())
+			return;
+
+		//x1 and x2 don't depend on the nudge, so the analyzer only has to be run once per event
+		SFPAnalyzer analyzer(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.beamEnergy,
+							 m_params.spsAngle, m_params.BField, m_params.nudge, m_params.Q);
+		BuiltFileReader reader;
+		CoincEvent event;
+		ProcessedEvent pevent;
+		for(int i=m_params.runMin; i<=m_params.runMax && long(tuner.GetNumberOfEvents()) < params.sampleEvents; i++)
+		{
+			std::string sortfile = m_workspace->GetRunFile(RunStage::Built, i);
+			if(sortfile.empty() || !reader.Open(sortfile))
+				continue;
+			for(Long64_t entry=0; entry<reader.GetEntries() && long(tuner.GetNumberOfEvents()) < params.sampleEvents; entry++)
+			{
+				event = reader.GetEntry(entry);
+				pevent = analyzer.GetProcessedEvent(event);
+				if(pevent.x1 != -1e6 && pevent.x2 != -1e6)
+					tuner.AddEvent(pevent.x1, pevent.x2);
+			}
+			reader.Close();
+			analyzer.ClearHashTable();
+		}
+
+		if(tuner.GetNumberOfEvents() == 0)
+		{
+			EVB_ERROR("No built events with both focal plane positions found in the range [{0}, {1}]; nothing to tune.", m_params.runMin, m_params.runMax);
+			return;
+		}
+
+		EVB_INFO("Tuning nudge over {0} candidates in [{1}, {2}] with {3} events, xavg window [{4}, {5}] mm...", params.nudge.steps,
+				 params.nudge.min, params.nudge.max, tuner.GetNumberOfEvents(), params.xavgMin, params.xavgMax);
+		tuner.SetThreadAffinity(m_params.affinityParams);
+		auto trials = tuner.Run(params, m_params.analysisThreads);
+
+		const NudgeTrial* best = nullptr;
+		for(auto& trial : trials)
+		{
+			if(trial.width >= 0.0 && (best == nullptr || trial.width < best->width))
+				best = &trial;
+		}
+		if(best == nullptr)
+		{
+			EVB_ERROR("Unable to fit the xavg peak for any candidate; check TuneXavgWindow(mm).");
+			return;
+		}
+
+		std::string tune_file = m_workspace->GetHistogramDir() + "nudge_tune_" + std::to_string(m_params.runMin) + "_" + std::to_string(m_params.runMax) + ".root";
+		tuner.Write(trials, params, tune_file);
+		EVB_INFO("Best nudge {0} (w1={1}, w2={2}) with xavg sigma {3} mm. Widths written to {4}.", best->nudge, best->w1, best->w2, best->width, tune_file);
+		if(best->nudge == 0.0)
+			EVB_WARN("A Nudge of 0 in the config is read as 1; use a small non-zero value instead.");
+	}
+
+	// Evaluate the focal plane shift and x-average weights over a kinematic grid
+	void EVBApp::ScanReaction()
+	{
+		if(m_workspace == nullptr || !m_workspace->IsValid())
+		{
+			EVB_ERROR("Unable to preform reaction scan due to bad workspace.");
+			return;
+		}
+
+		//Axes not given in the config are pinned to the nominal reaction
+		auto resolveAxis = [](const ScanAxis& axis, double nominal)
+		{
+			ScanAxis resolved = axis;
+			if(resolved.steps <= 0)
+				resolved = { nominal, nominal, 1 };
+			return resolved;
+		};
+		ReactionScanParameters params;
+		params.beamEnergy = resolveAxis(m_params.scanParams.beamEnergy, m_params.beamEnergy);
+		params.angle = resolveAxis(m_params.scanParams.angle, m_params.spsAngle);
+		params.bfield = resolveAxis(m_params.scanParams.bfield, m_params.BField);
+		params.Q = resolveAxis(m_params.scanParams.Q, m_params.Q);
+
+		std::string scan_file = m_workspace->GetHistogramDir()+"reaction_scan.root";
+		EVB_INFO("Scanning reaction over {0} beam energies, {1} angles, {2} fields, and {3} Q values...", params.beamEnergy.steps,
+				 params.angle.steps, params.bfield.steps, params.Q.steps);
+
+		ReactionScan scanner(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.nudge);
+		if(!scanner.IsValid())
+			return;
+		auto points = scanner.Run(params);
+		scanner.Write(points, scan_file);
+		EVB_INFO("Wrote {0} scan points to {1}.", points.size(), scan_file);
+	}
+	
 	// Convert the binary files to ROOT files
 	void EVBApp::Convert2RawRoot() 
 	{
@@ -307,20 +626,91 @@ namespace EventBuilder {
 	}
 	
 	void EVBApp::Convert2SlowAnalyzedRoot()
+	{
+		ConvertAnalyzedRuns(false, false, false);
+	}
+	
+	void EVBApp::Convert2FastAnalyzedRoot() 
+	{
+		ConvertAnalyzedRuns(true, false, false);
+	}
+
+	/*
+		Convert binary archives to analyzed files. If merge and/or plot are requested, every analyzed event is
+		also sent straight to the merged tree and/or the histogrammer while it is in memory, rather than
+		re-reading the analyzed files afterwards in separate Merge and Plot passes.
+	*/
+	void EVBApp::ConvertAnalyzedRuns(bool fast, bool merge, bool plot)
 	{
 		if(m_workspace == nullptr || !m_workspace->IsValid())
 		{
 			EVB_ERROR("Unable to preform event building request due to bad workspace.");
+			return;
 		}
 
 		std::string sortroot_dir = m_workspace->GetAnalyzedDir();
-		EVB_INFO("Converting binary archives to analyzed event built ROOT files over run range [{0}, {1}]",m_params.runMin,m_params.runMax);
+		std::string range = "run_"+std::to_string(m_params.runMin)+"_"+std::to_string(m_params.runMax)+".root";
+		if(fast)
+			EVB_INFO("Converting binary archives to analyzed fast event built ROOT files over run range [{0}, {1}]",m_params.runMin,m_params.runMax);
+		else
+			EVB_INFO("Converting binary archives to analyzed event built ROOT files over run range [{0}, {1}]",m_params.runMin,m_params.runMax);
+
+		if(!m_params.writeAnalyzedTree)
+		{
+			if(!merge && !plot)
+				EVB_WARN("WriteAnalyzedTree is off and no Merge/Plot is chained; analyzed events will not be kept anywhere.");
+			else
+				EVB_INFO("WriteAnalyzedTree is off; run statistics go to run_N_stats.root, existing analyzed files are left untouched.");
+		}
+
+		AnalyzedEventSinks sinks;
+
+		TFile* merge_output = nullptr;
+		TTree* merge_tree = nullptr;
+		ProcessedEvent merge_event;
+		std::unique_ptr<TreeWriter> merge_writer;
+		if(merge)
+		{
+			std::string merge_file = m_workspace->GetMergedDir()+range;
+			merge_output = TFile::Open(merge_file.c_str(), "RECREATE");
+			if(!merge_output || !merge_output->IsOpen())
+			{
+				EVB_ERROR("Could not open output file {0} for merge", merge_file);
+				return;
+			}
+			EVB_INFO("Merged file will be named {0}", merge_file);
+			merge_tree = new TTree("SPSTree", "SPSTree");
+			merge_tree->Branch("event", &merge_event);
+			merge_writer = std::make_unique<TreeWriter>(merge_tree);
+			sinks.mergeWriter = merge_writer.get();
+			sinks.mergeEvent = &merge_event;
+		}
+
+		SFPPlotter grammer;
+		if(plot)
+		{
+			std::string plot_file = m_workspace->GetHistogramDir()+range;
+			grammer.ApplyCutlist(m_params.cutListFile);
+			if(!grammer.Begin(plot_file))
+			{
+				EVB_ERROR("Could not open histogram file {0}", plot_file);
+				if(merge_output)
+				{
+					merge_output->Close();
+					delete merge_output;
+				}
+				return;
+			}
+			EVB_INFO("Histograms will be written to {0} with Cut List {1}", plot_file, m_params.cutListFile);
+			sinks.plotter = &grammer;
+		}
 
 		std::string sortfile;
 	
 		CompassRun converter(m_params, m_workspace);
 		converter.SetProgressCallbackFunc(m_progressCallback);
 		converter.SetProgressFraction(m_progressFraction);
+		converter.SetAnalyzedEventSinks(sinks);
 
 		EVB_INFO("Beginning conversion...");
 		int count = 0;
@@ -332,55 +722,111 @@ namespace EventBuilder {
 			if(m_workspace->UnpackBinaryRunToTemp(i))
 			{
 				converter.SetRunNumber(i);
-				converter.Convert2SlowAnalyzedRoot(sortfile);
+				if(fast)
+					converter.Convert2FastAnalyzedRoot(sortfile);
+				else
+					converter.Convert2SlowAnalyzedRoot(sortfile);
 				++count;
 			}
 			m_workspace->ClearTempDirectory();
 		}
 
+		if(merge)
+		{
+			merge_output->cd();
+			merge_writer->Write();
+			merge_output->Close();
+			delete merge_output;
+		}
+		if(plot)
+			grammer.End();
+
 		if(count != 0)
 			EVB_INFO("Conversion complete.");
 		else
 			EVB_WARN("Nothing converted, no files found in the range [{0}, {1}]", m_params.runMin, m_params.runMax);
 	}
-	
-	void EVBApp::Convert2FastAnalyzedRoot() 
+
+	bool EVBApp::IsValidOperation(const std::string& operation)
 	{
-		if(m_workspace == nullptr || !m_workspace->IsValid())
+		static const std::vector<std::string> operations = {
+			"Convert", "ConvertSlow", "ConvertFast", "ConvertSlowA", "ConvertFastA", "Merge", "Plot", "Scan", "Reanalyze", "TuneNudge"
+		};
+		return std::find(operations.begin(), operations.end(), operation) != operations.end();
+	}
+
+	bool EVBApp::RunOperation(const std::string& operation)
+	{
+		if(operation == "Convert")
+			Convert2RawRoot();
+		else if(operation == "Merge")
+			MergeROOTFiles();
+		else if(operation == "Plot")
+			PlotHistograms();
+		else if (operation == "ConvertSlow")
+			Convert2SortedRoot();
+		else if (operation == "ConvertFast")
+			Convert2FastSortedRoot();
+		else if (operation == "ConvertSlowA")
+			Convert2SlowAnalyzedRoot();
+		else if (operation == "ConvertFastA")
+			Convert2FastAnalyzedRoot();
+		else if (operation == "Scan")
+			ScanReaction();
+		else if (operation == "Reanalyze")
+			ReanalyzeBuiltFiles();
+		else if (operation == "TuneNudge")
+			TuneNudge();
+		else 
 		{
-			EVB_ERROR("Unable to preform event building request due to bad workspace.");
+			EVB_ERROR("Invalid operation {0} given to EventBuilder!", operation);
+			return false;
 		}
+		return true;
+	}
 
-		std::string sortroot_dir = m_workspace->GetAnalyzedDir();
-		EVB_INFO("Converting binary archives to analyzed fast event built ROOT files over run range [{0}, {1}]",m_params.runMin,m_params.runMax);
-		
-	
-		std::string sortfile;
-	
-		CompassRun converter(m_params, m_workspace);
-		converter.SetProgressCallbackFunc(m_progressCallback);
-		converter.SetProgressFraction(m_progressFraction);
-
-		EVB_INFO("Beginning conversion...");
-		int count = 0;
-		for(int i=m_params.runMin; i<=m_params.runMax; i++) 
+	/*
+		Run several operations in order with one configuration. A ConvertSlowA/ConvertFastA followed directly
+		by Merge and/or Plot is fused into a single pass over the data (see ConvertAnalyzedRuns).
+	*/
+	bool EVBApp::RunOperationChain(const std::vector<std::string>& operations)
+	{
+		if(operations.empty())
 		{
-			sortfile = sortroot_dir + "run_"+ std::to_string(i) + ".root";
-			EVB_INFO("Converting file {0}...", sortfile);
-			m_workspace->ClearTempDirectory(); //In case something weird happened
-			if(m_workspace->UnpackBinaryRunToTemp(i))
+			EVB_ERROR("No operation given to EventBuilder!");
+			return false;
+		}
+		for(auto& operation : operations)
+		{
+			if(!IsValidOperation(operation))
 			{
-				converter.SetRunNumber(i);
-				converter.Convert2FastAnalyzedRoot(sortfile);
-				++count;
+				EVB_ERROR("Invalid operation {0} given to EventBuilder!", operation);
+				return false;
 			}
-			m_workspace->ClearTempDirectory();
 		}
 
-		if(count != 0)
-			EVB_INFO("Conversion complete.");
-		else
-			EVB_WARN("Nothing converted, no files found in the range [{0}, {1}]", m_params.runMin, m_params.runMax);
+		for(std::size_t i=0; i<operations.size(); i++)
+		{
+			const std::string& operation = operations[i];
+			if(operation == "ConvertSlowA" || operation == "ConvertFastA")
+			{
+				bool merge = false, plot = false;
+				while(i+1 < operations.size() && ((operations[i+1] == "Merge" && !merge) || (operations[i+1] == "Plot" && !plot)))
+				{
+					++i;
+					if(operations[i] == "Merge")
+						merge = true;
+					else
+						plot = true;
+				}
+				if(merge || plot)
+					EVB_INFO("Fusing {0} with{1}{2} into a single pass", operation, merge ? " Merge" : "", plot ? " Plot" : "");
+				ConvertAnalyzedRuns(operation == "ConvertFastA", merge, plot);
+			}
+			else
+				RunOperation(operation);
+		}
+		return true;
 	}
 
 }
\ No newline at end of file
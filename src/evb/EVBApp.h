@@ -31,6 +31,13 @@ namespace EventBuilder {
 		void Convert2FastSortedRoot();
 		void Convert2SlowAnalyzedRoot();
 		void Convert2FastAnalyzedRoot();
+		void ReanalyzeBuiltFiles();
+		void ScanReaction();
+		void TuneNudge();
+
+		bool RunOperation(const std::string& operation);
+		bool RunOperationChain(const std::vector<std::string>& operations); //fuses ConvertXA with a following Merge/Plot
+		static bool IsValidOperation(const std::string& operation);
 	
 		void SetParameters(const EVBParameters& params);
 		inline EVBParameters& GetParameters() { return m_params; }
@@ -47,10 +54,16 @@ namespace EventBuilder {
 			ConvertFast,
 			ConvertFastA,
 			Merge,
-			Plot
+			Plot,
+			Scan,
+			Reanalyze,
+			Tune,
+			ConvertFastAPlot
 		};
 	
 	private:
+		void ConvertAnalyzedRuns(bool fast, bool merge, bool plot);
+
 		EVBParameters m_params;
 		std::shared_ptr<EVBWorkspace> m_workspace;
 		double m_progressFraction;
@@ -1,6 +1,11 @@
 #ifndef EVB_PARAMETERS_H
 #define EVB_PARAMETERS_H
 
+#include "WaveformDSP.h"
+#include "ReactionScan.h"
+#include "NudgeTuner.h"
+#include "ThreadTopology.h"
+
 namespace EventBuilder {
 
 	struct EVBParameters
@@ -17,6 +22,23 @@ namespace EventBuilder {
 		double slowCoincidenceWindow = 3.0e6;
 		double fastCoincidenceWindowIonCh = 0.0;
 		double fastCoincidenceWindowSABRE = 0.0;
+		int slowSortHitCapacity = 8192; //max hits held in a single slow window
+		double readBufferBudget = 1024.0; //MB, shared by the read buffers of all files in a run
+		double rateMonitorBinWidth = 0.0; //s, 0 disables the rate monitor histograms
+		double scalerRateBinWidth = 0.0; //s, 0 disables time-binned scaler rates
+		double reorderHorizon = 0.0; //ps, 0 disables the reorder stage
+		int reorderCapacity = 65536; //max hits held by the reorder stage
+		int analysisThreads = 1; //threads for Reanalyze and the analyzed conversions; 1 = serial, 0 = all cores
+		int writerThreads = 1; //ROOT implicit MT threads for output compression; 0 = all cores, 1 = serial
+		bool compactBuiltFiles = false; //write sorted output as CompactEvent rather than CoincEvent
+		bool writeColumnarCache = false; //write run_N.cols/ next to analyzed files for fast replotting
+		bool writeAnalyzedTree = true; //false writes only run statistics, to run_N_stats.root; events go to chained Merge/Plot only
+
+		//Event building mode: "Fixed" (window opened by the first hit) or "Triggered"
+		std::string eventBuildMode = "Fixed";
+		std::string triggerChannel = "SCINTLEFT"; //focal plane part name or global channel
+		double triggerPreWindow = 1.5e6; //ps
+		double triggerPostWindow = 1.5e6; //ps
 
 		int ZT = 6;
 		int AT = 12;
@@ -31,6 +53,22 @@ namespace EventBuilder {
 		
 		double nudge = 0.0;
 		double Q = 0.0;
+
+		double catrinaPSDThreshold = 0.2; //tail/total above which a CATRiNA hit is called a neutron
+
+		//Grid for the Scan operation; unscanned axes use the values above
+		ReactionScanParameters scanParams;
+
+		//Candidates and peak window for the TuneNudge operation
+		NudgeTuneParameters tuneParams;
+
+		//Core/NUMA pinning of the conversion thread and parallel workers
+		ThreadAffinityParameters affinityParams;
+
+		//Waveform handling, only used if CoMPASS saved waves
+		bool keepWaveforms = false;
+		bool waveDSP = false;
+		WaveDSPParameters waveDSPParams;
 	};
 }
 
@@ -30,7 +30,11 @@ namespace EventBuilder {
         Init();
     }
 
-    EVBWorkspace::~EVBWorkspace() {}
+    EVBWorkspace::~EVBWorkspace()
+    {
+        if(m_isValid && m_catalogue.IsModified())
+            m_catalogue.Save(m_catalogueFile);
+    }
 
     void EVBWorkspace::Init()
     {
@@ -83,65 +87,38 @@ namespace EventBuilder {
         if(!m_isValid)
             return;
         m_isValid = CheckSubDirectory(m_mergedDir);
-    }
+        if(!m_isValid)
+            return;
 
-    std::string EVBWorkspace::GetBinaryRun(int run)
-    {
-        std::string file;
-        std::string runID = "run_" + std::to_string(run) + ".tar.gz";
-        for(auto& entry : std::filesystem::directory_iterator(m_binaryDir))
-        {
-            if(entry.is_regular_file() && entry.path().filename().string() == runID)
-            {
-                return entry.path().string();
-            }
-        }
-        return "";
+        m_catalogue.AddStage(RunStage::Raw, m_binaryDir, "run_", ".tar.gz");
+        m_catalogue.AddStage(RunStage::Sorted, m_sortedDir, "compass_run_", ".root");
+        m_catalogue.AddStage(RunStage::Built, m_builtDir, "run_", ".root");
+        m_catalogue.AddStage(RunStage::Analyzed, m_analyzedDir, "run_", ".root");
+        m_catalogueFile = m_workspace + "run_catalogue.txt";
+        m_catalogue.Load(m_catalogueFile);
     }
 
-    std::string EVBWorkspace::GetAnalyzedRun(int run)
+    std::string EVBWorkspace::GetRunFile(RunStage stage, int run)
     {
-        std::string file;
-        std::string runID = "run_" + std::to_string(run) + ".root";
-        for(auto& entry : std::filesystem::directory_iterator(m_analyzedDir))
-        {
-            if(entry.is_regular_file() && entry.path().filename().string() == runID)
-            {
-                return entry.path().string();
-            }
-        }
-        return "";
+        const RunFileInfo* info = m_catalogue.FindRun(stage, run);
+        return info == nullptr ? "" : info->path;
     }
 
     std::vector<std::string> EVBWorkspace::GetBinaryRunRange(int runMin, int runMax)
     {
-        std::vector<std::string> list;
-        std::string temp;
-        for(int run=runMin; run<=runMax; run++)
-            temp = GetBinaryRun(run);
-            if(!temp.empty())
-                list.push_back(temp);
-
-        return list;
+        return m_catalogue.GetRunRange(RunStage::Raw, runMin, runMax);
     }
 
     std::vector<std::string> EVBWorkspace::GetAnalyzedRunRange(int runMin, int runMax)
     {
-        std::vector<std::string> list;
-        std::string temp;
-        for(int run=runMin; run<=runMax; run++)
-        {   
-            temp = GetAnalyzedRun(run);
-            if(!temp.empty())
-                list.push_back(temp);
-        }
-
-        return list;
+        return m_catalogue.GetRunRange(RunStage::Analyzed, runMin, runMax);
     }
 
     bool EVBWorkspace::UnpackBinaryRunToTemp(int run)
     {
-        std::string runfile = GetBinaryRun(run);
+        std::string runfile = GetRunFile(RunStage::Raw, run);
+        if(runfile.empty())
+            return false;
         std::string unpack_command = "tar -xzf "+runfile+" --directory "+m_tempDir;
 		int	sys_return = system(unpack_command.c_str());
         if(sys_return == 0)
@@ -200,7 +177,7 @@ namespace EventBuilder {
             return false;
         }
 
-        TChain* chain = new TChain("SPSTree", "SPSTree");
+        TChain* chain = new TChain("SPSTree");
         for(auto& entry : files)
         {   
             EVB_INFO("Merging file: {0}", entry);
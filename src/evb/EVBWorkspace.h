@@ -1,6 +1,8 @@
 #ifndef EVB_WORKSPACE_H
 #define EVB_WORKSPACE_H
 
+#include "RunCatalogue.h"
+
 namespace EventBuilder {
 
     class EVBWorkspace
@@ -22,6 +24,7 @@ namespace EventBuilder {
 
         std::vector<std::string> GetBinaryRunRange(int runMin, int runMax);
         std::vector<std::string> GetAnalyzedRunRange(int runMin, int runMax);
+        std::string GetRunFile(RunStage stage, int run); //empty if the run has no file at this stage
         
         bool UnpackBinaryRunToTemp(int run); //Currently Linux/MacOS only. Windows support to come.
         std::vector<std::string> GetTempFiles();
@@ -31,8 +34,6 @@ namespace EventBuilder {
 
     private:
         void Init();
-        std::string GetBinaryRun(int run);
-        std::string GetAnalyzedRun(int run);
         bool m_isValid;
 
         std::string m_workspace;
@@ -45,6 +46,9 @@ namespace EventBuilder {
         std::string m_histogramDir;
         std::string m_cutDir;
         std::string m_mergedDir;
+
+        RunCatalogue m_catalogue;
+        std::string m_catalogueFile;
     };
 }
 
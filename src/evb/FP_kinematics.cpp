@@ -31,6 +31,9 @@
 
   Added a nudge factor to adjust delta-z for resolution optimization JCE -- June 2024
 
+  Masses looked up once per reaction (ReactionMasses) so that Delta_Z can be evaluated
+  over a grid by ReactionScan
+
 */
 
 #include <cmath>
@@ -39,6 +42,20 @@
 
 namespace EventBuilder {
 
+	bool GetReactionMasses(int ZT, int AT, int ZP, int AP, int ZE, int AE, ReactionMasses& masses)
+	{
+		const MassLookup& table = MassLookup::GetInstance();
+		int ZR = ZT + ZP - ZE, AR = AT + AP - AE;
+
+		masses.target = table.FindMass(ZT, AT);
+		masses.projectile = table.FindMass(ZP, AP);
+		masses.ejectile = table.FindMass(ZE, AE);
+		masses.residual = table.FindMass(ZR, AR);
+		masses.ZE = ZE;
+
+		return masses.target*masses.projectile*masses.ejectile*masses.residual != 0;
+	}
+
 	//requires (Z,A) for T, P, and E, as well as energy of P,
 	// spectrograph angle of interest, and field value
 	// added an input for the nudge factor to adjust delta-z 
@@ -46,12 +63,33 @@ namespace EventBuilder {
 	
 	double Delta_Z(int ZT, int AT, int ZP, int AP, int ZE, int AE,
 		       double EP, double angle, double B, double nudge, double Q) 
+	{
+		ReactionMasses masses;
+		if(!GetReactionMasses(ZT, AT, ZP, AP, ZE, AE, masses)) 
+		{
+			EVB_WARN("Illegal mass at FP_kinematics::Delta_Z! Returning offset of 0.");
+			return 0;
+		}
+
+		double groundQ = masses.target + masses.projectile - masses.ejectile - masses.residual;
+		if(Q == 0)
+			EVB_INFO("Computed Q value: {0} MeV", groundQ); // g.s. Q-value
+		else
+			EVB_INFO("Computed Excitation Q value: {0} MeV", groundQ - Q); // excited state Q-value
+
+		if(nudge == 0)
+			EVB_INFO("Input 0 detected! Nudge value: 1"); // default value (no nudge)
+		else
+			EVB_INFO("Nudge value: {0}", nudge);
+
+		return Delta_Z(masses, EP, angle, B, nudge, Q);
+	}
+
+	double Delta_Z(const ReactionMasses& masses, double EP, double angle, double B, double nudge, double Q)
 	{
 	
 		/* CONSTANTS */
-		const double UTOMEV = 931.4940954; //MeV per u;
 		const double MEVTOJ = 1.60218E-13; //J per MeV
-		const double RESTMASS_ELECTRON = 0.000548579909; //amu
 		const double UNIT_CHARGE = 1.602E-19; //Coulombs
 		const double C = 2.9979E8; //m/s
 	
@@ -60,29 +98,17 @@ namespace EventBuilder {
 		const double MAG = 0.39; //magnification in x
 		const double DEGTORAD = M_PI/180.;
 	
-		int ZR = ZT + ZP - ZE, AR = AT + AP - AE;
 		double EE=0; //ejectile energy
 	
-		double MT=0, MP=0, ME=0, MR=0; //masses (MeV)
+		const double MT = masses.target, MP = masses.projectile, ME = masses.ejectile, MR = masses.residual; //masses (MeV)
+		if (MT*MP*ME*MR == 0) 
+			return 0;
 	
 		B /= 10000; //convert to tesla
 		angle *= DEGTORAD; // convert to radians
-	
-		MT = MASS.FindMass(ZT, AT);
-		MP = MASS.FindMass(ZP, AP);
-		ME = MASS.FindMass(ZE, AE);
-		MR = MASS.FindMass(ZR, AR);
-		
-		if (MT*MP*ME*MR == 0) 
-		{
-			EVB_WARN("Illegal mass at FP_kinematics::Delta_Z! Returning offset of 0.");
-			return 0;
-		}
 
-		// debugging print statements
-		if(Q==0){Q = MT + MP - ME - MR; std::cout << "Computed Q value: " << Q << " MeV" << std::endl;} // g.s. Q-value
-		else{ Q = (MT + MP - ME - MR) - Q; std::cout << "Computed Excitation Q value: " << Q << std::endl;} // excited state Q-value
-		
+		if(Q==0) Q = MT + MP - ME - MR; // g.s. Q-value
+		else Q = (MT + MP - ME - MR) - Q; // excited state Q-value
 		
 		//kinematics a la Iliadis p.590
 		double term1 = sqrt(MP*ME*EP)/(ME + MR)*cos(angle);
@@ -96,7 +122,7 @@ namespace EventBuilder {
 		double PE = sqrt(EE*(EE+2*ME));
 	
 		//calculate rho from B a la B*rho = (proj. momentum)/(proj. charge)
-		double rho = (PE*MEVTOJ)/(ZE*UNIT_CHARGE*C*B)*100; //in cm
+		double rho = (PE*MEVTOJ)/(masses.ZE*UNIT_CHARGE*C*B)*100; //in cm
 	
 		double K;
 	
@@ -109,11 +135,8 @@ namespace EventBuilder {
 		K /= denom;
 
 
-
-
 		// arbitrary nudge factor to adjust delta-z for resolution optimization 
-		if(nudge==0){nudge=1.0;std::cout << "Input 0 detected! Nudge value: " << nudge << std::endl;} // default value (no nudge)
-		else{nudge=nudge;std::cout << "Nudge value: " << nudge << std::endl;}
+		if(nudge==0) nudge=1.0; // default value (no nudge)
 
 		// account for the 45 deg tilt from central ray of the focal plane detector
 		double theta = 0.785398163; // 45 degrees in rads
@@ -34,10 +34,23 @@
 
 namespace EventBuilder {
 
+     //nuclear masses (MeV) of a reaction, looked up once so that Delta_Z can be
+     //evaluated repeatedly (e.g. in a ReactionScan) without touching the mass table
+     struct ReactionMasses
+     {
+          double target = 0, projectile = 0, ejectile = 0, residual = 0;
+          int ZE = 0;
+     };
+
+     bool GetReactionMasses(int ZT, int AT, int ZP, int AP, int ZE, int AE, ReactionMasses& masses);
+
      //requires (Z,A) for T, P, and E, as well as energy of P,
      // spectrograph angle of interest, and field value
      double Delta_Z(int ZT, int AT, int ZP, int AP, int ZE, int AE,
      	       double EP, double angle, double B, double nudge, double Q); 
+
+     //same as above with the masses already looked up; does not log
+     double Delta_Z(const ReactionMasses& masses, double EP, double angle, double B, double nudge, double Q);
      
      double Wire_Dist();
 
@@ -3,28 +3,16 @@
 namespace EventBuilder {
 	//windows given in picoseconds, converted to nanoseconds
 	FastSort::FastSort(float si_windowSize, float ion_windowSize) :
-		si_coincWindow(si_windowSize/1.0e3), ion_coincWindow(ion_windowSize/1.0e3), event_address(nullptr)
+		si_coincWindow(si_windowSize/1.0e3), ion_coincWindow(ion_windowSize/1.0e3)
 	{
 	}
 	
 	FastSort::~FastSort() 
 	{
-		delete event_address;
-	}
-	
-	void FastSort::ResetSABRE() 
-	{
-		for(int i=0; i<5; i++)
-			fastEvent.sabreArray[i] = sblank;
-	}
-	
-	void FastSort::ResetFocalPlane() 
-	{
-		fastEvent.focalPlane = fpblank;
 	}
 	
 	/*Assign a set of ion chamber data to the scintillator*/
-	void FastSort::ProcessFocalPlane(unsigned int scint_index, unsigned int ionch_index) {
+	void FastSort::ProcessFocalPlane(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index, unsigned int ionch_index) {
 	
 	  /*In order to have a coincidence window, one must choose a portion of the ion chamber to form a requirement.
 	   *In this case, I chose one of the anodes. But in principle you could also choose any other part of the ion
@@ -63,13 +51,10 @@ namespace EventBuilder {
 	}
 	
 	/*Assign a set of SABRE data that falls within the coincidence window*/
-	void FastSort::ProcessSABRE(unsigned int scint_index) 
+	void FastSort::ProcessSABRE(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index) 
 	{
 		for(int i=0; i<5; i++) 
 		{ //loop over SABRE silicons
-			std::vector<DetectorHit> rings;
-			std::vector<DetectorHit> wedges;
-	
 			if(slowEvent.sabreArray[i].rings.size() == 0 || slowEvent.sabreArray[i].wedges.size() == 0) 
 				continue; //save some time on empties
 	
@@ -78,25 +63,37 @@ namespace EventBuilder {
 			{
 				float sabreRelTime = fabs(slowEvent.sabreArray[i].rings[j].Time - slowEvent.focalPlane.scintL[scint_index].Time);
 				if(sabreRelTime < si_coincWindow)
-					rings.push_back(slowEvent.sabreArray[i].rings[j]);
+					fastEvent.sabreArray[i].rings.push_back(slowEvent.sabreArray[i].rings[j]);
 			}
 			for(unsigned int j=0; j<slowEvent.sabreArray[i].wedges.size(); j++) 
 			{
 				float sabreRelTime = fabs(slowEvent.sabreArray[i].wedges[j].Time - slowEvent.focalPlane.scintL[scint_index].Time);
 				if(sabreRelTime < si_coincWindow) 
-					wedges.push_back(slowEvent.sabreArray[i].wedges[j]);
+					fastEvent.sabreArray[i].wedges.push_back(slowEvent.sabreArray[i].wedges[j]);
 			}
-		
-			fastEvent.sabreArray[i].rings = rings;
-			fastEvent.sabreArray[i].wedges = wedges;
 		}
 	}
 	
-	std::vector<CoincEvent> FastSort::GetFastEvents(CoincEvent& event) 
+	/*Assign the CATRiNA hits that fall within the coincidence window. Uses the SABRE (si) window, as both are gated on the scint*/
+	void FastSort::ProcessCatrina(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index) 
 	{
-		slowEvent = event;
-		std::vector<CoincEvent> fast_events;
+		for(int i=0; i<7; i++) 
+		{
+			for(unsigned int j=0; j<slowEvent.catrinaArray[i].catr.size(); j++) 
+			{
+				float catrinaRelTime = fabs(slowEvent.catrinaArray[i].catr[j].Time - slowEvent.focalPlane.scintL[scint_index].Time);
+				if(catrinaRelTime < si_coincWindow)
+					fastEvent.catrinaArray[i].catr.push_back(slowEvent.catrinaArray[i].catr[j]);
+			}
+		}
+	}
 	
+	/*
+		One fast event per (scint, ion chamber index) pair. Events are filled in place at the front of m_fastEvents,
+		which only ever grows, so once it has reached the largest split seen no list is allocated again.
+	*/
+	FastEventRange FastSort::GetFastEvents(const HitEvent& slowEvent) 
+	{
 		unsigned int sizeArray[7];
 		sizeArray[0] = slowEvent.focalPlane.delayFL.size();
 		sizeArray[1] = slowEvent.focalPlane.delayFR.size();
@@ -106,22 +103,38 @@ namespace EventBuilder {
 		sizeArray[5] = slowEvent.focalPlane.anodeB.size();
 		sizeArray[6] = slowEvent.focalPlane.cathode.size();
 		unsigned int maxSize = *std::max_element(sizeArray, sizeArray+7);
+		std::size_t nFastEvents = slowEvent.focalPlane.scintL.size()*maxSize;
+		if(m_fastEvents.size() < nFastEvents)
+			m_fastEvents.resize(nFastEvents);
+
+		std::size_t index = 0;
 		//loop over scints
 		for(unsigned int i=0; i<slowEvent.focalPlane.scintL.size(); i++) 
 		{
-			ResetSABRE();
-			ProcessSABRE(i);
 			//loop over ion chamber
 			//NOTE: as written, this dumps data that does not have an ion chamber hit!
 			//If you want scint/SABRE singles, move the fill outside of this loop
 			for(unsigned int j=0; j<maxSize; j++) 
 			{
-				ResetFocalPlane();
-				ProcessFocalPlane(i, j);
-				fast_events.push_back(fastEvent);
+				HitEvent& fastEvent = m_fastEvents[index++];
+				ClearHitEvent(fastEvent);
+				if(j == 0)
+				{
+					ProcessSABRE(slowEvent, fastEvent, i);
+					ProcessCatrina(slowEvent, fastEvent, i);
+				}
+				else
+				{
+					const HitEvent& first = m_fastEvents[index - 1 - j]; //same scint, same SABRE and CATRiNA hits
+					for(int s=0; s<5; s++)
+						fastEvent.sabreArray[s] = first.sabreArray[s];
+					for(int c=0; c<7; c++)
+						fastEvent.catrinaArray[c] = first.catrinaArray[c];
+				}
+				ProcessFocalPlane(slowEvent, fastEvent, i, j);
 			}
 		}
-		return fast_events;
+		return { m_fastEvents.data(), m_fastEvents.data() + nFastEvents };
 	}
 
-}
\ No newline at end of file
+}
@@ -6,30 +6,37 @@
 #ifndef FASTSORT_H
 #define FASTSORT_H
 
-#include "DataStructs.h"
+#include "HitEvent.h"
 #include <TH2.h>
 
 namespace EventBuilder {
 
+	//The fast events of one slow event; valid until the next GetFastEvents() call
+	struct FastEventRange
+	{
+		const HitEvent* first = nullptr;
+		const HitEvent* last = nullptr;
+
+		inline const HitEvent* begin() const { return first; }
+		inline const HitEvent* end() const { return last; }
+		inline std::size_t size() const { return last - first; }
+	};
+
 	class FastSort 
 	{
 	  
 	public:
 		FastSort(float si_windowSize, float ion_windowSize);
 		~FastSort();
-		std::vector<CoincEvent> GetFastEvents(CoincEvent& event);
+		FastEventRange GetFastEvents(const HitEvent& slowEvent); //valid until the next call
 	
 	private:
-		void ResetSABRE();
-		void ResetFocalPlane();
-		void ProcessSABRE(unsigned int scint_index);
-		void ProcessFocalPlane(unsigned int scint_index, unsigned int ionch_index);
+		void ProcessSABRE(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index);
+		void ProcessCatrina(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index);
+		void ProcessFocalPlane(const HitEvent& slowEvent, HitEvent& fastEvent, unsigned int scint_index, unsigned int ionch_index);
 	
 		float si_coincWindow, ion_coincWindow;
-		CoincEvent *event_address, slowEvent;
-		CoincEvent fastEvent, blank;
-		SabreDetector sblank;
-		FPDetector fpblank;
+		std::vector<HitEvent> m_fastEvents; //reused from call to call and never shrunk, so list storage is kept
 	
 	};
 
@@ -2,14 +2,37 @@
 
 namespace EventBuilder {
 
+	//Flag bits with a known meaning, in the order they are reported
+	static const std::vector<std::pair<int, std::string>> s_flagNames = {
+		{0, "Dead time incurred (only for V1724)"},
+		{1, "Timestamp rollovers"},
+		{2, "Timestamp resets from external"},
+		{3, "Fake events"},
+		{4, "Memory full"},
+		{5, "Triggers lost"},
+		{6, "N Triggers lost"},
+		{7, "Saturation within the gate"},
+		{8, "1024 Triggers found"},
+		{10, "Saturation on input"},
+		{11, "N Triggers counted"},
+		{12, "Events not matched"},
+		{14, "Fine time stamp"},
+		{15, "Pile ups"},
+		{19, "PLL lock lost"},
+		{20, "Over Temperature"},
+		{21, "ADC Shutdown"}
+	};
+
 	FlagHandler::FlagHandler() : 
 		log("./event_log.txt")
 	{
+		m_channels.resize(144);
 	}
 	
 	FlagHandler::FlagHandler(const std::string& filename) :
 		log(filename)
 	{
+		m_channels.resize(144);
 	}
 	
 	FlagHandler::~FlagHandler() 
@@ -17,90 +40,68 @@ namespace EventBuilder {
 		WriteLog();
 		log.close();
 	}
-	
-	void FlagHandler::CheckFlag(int board, int channel, int flag) 
+
+	void FlagHandler::FlushChannel(ChannelCounts& counts)
 	{
-	
-		int gchan = channel + board*16;
-		FlagCount& counter = event_count_map[gchan]; //yikes
-	
-		counter.total_counts++;
-	
-		if(flag & DeadTime) 
-			counter.dead_time++;
-	
-		if(flag & TimeRollover) 
-			counter.time_roll++;
-	
-		if(flag & TimeReset) 
-			counter.time_reset++;
-	
-		if(flag & FakeEvent) 
-			counter.fake_event++;
-	
-		if(flag & MemFull) 
-			counter.mem_full++;
-	
-		if(flag & TrigLost) 
-			counter.trig_lost++;
-	
-		if(flag & NTrigLost) 
-			counter.n_trig_lost++;
-	
-		if(flag & SaturatingInGate) 
-			counter.sat_in_gate++;
-	
-		if(flag & Trig1024Counted) 
-			counter.trig_1024++;;
-	
-		if(flag & SaturatingInput) 
-			counter.sat_input++;
-	
-		if(flag & NTrigCounted) 
-			counter.n_trig_count++;
-	
-		if(flag & EventNotMatched) 
-			counter.event_not_matched++;
-	
-		if(flag & PileUp) 
-			counter.pile_up++;
-	
-		if(flag & PLLLockLoss) 
-			counter.pll_lock_loss++;
-	
-		if(flag & OverTemp) 
-			counter.over_temp++;
-	
-		if(flag & ADCShutdown) 
-			counter.adc_shutdown++;
-	
+		for(int bit=0; bit<s_nBits; bit++)
+		{
+			counts.bitTotals[bit] += counts.accumulator[bit];
+			counts.accumulator[bit] = 0;
+		}
+		counts.pending = 0;
+	}
+
+	void FlagHandler::FlushAll()
+	{
+		for(auto& counts : m_channels)
+		{
+			if(counts.pending != 0)
+				FlushChannel(counts);
+		}
+	}
+
+	/*
+		Write the counts as a TH2 of global channel vs. flag bit to the current ROOT directory. The last y bin
+		holds the total number of hits on the channel.
+	*/
+	void FlagHandler::WriteHistogram(const std::string& name)
+	{
+		FlushAll();
+
+		int nchannels = m_channels.size();
+		TH2D histo(name.c_str(), (name + ";global channel;flag bit;counts").c_str(), nchannels, 0, nchannels, s_nBits + 1, 0, s_nBits + 1);
+		for(int gchan=0; gchan<nchannels; gchan++)
+		{
+			const ChannelCounts& counts = m_channels[gchan];
+			if(counts.total == 0)
+				continue;
+			for(int bit=0; bit<s_nBits; bit++)
+			{
+				if(counts.bitTotals[bit] != 0)
+					histo.SetBinContent(gchan + 1, bit + 1, counts.bitTotals[bit]);
+			}
+			histo.SetBinContent(gchan + 1, s_nBits + 1, counts.total);
+		}
+		histo.GetYaxis()->SetBinLabel(s_nBits + 1, "Total");
+		histo.Write();
 	}
 	
 	void FlagHandler::WriteLog() 
 	{
+		FlushAll();
+
 		log<<"Event Flag Log"<<std::endl;
 		log<<"-----------------------------"<<std::endl;
-		for(auto& counter : event_count_map) 
+		for(std::size_t gchan=0; gchan<m_channels.size(); gchan++) 
 		{
+			const ChannelCounts& counts = m_channels[gchan];
+			if(counts.total == 0)
+				continue;
 			log<<"-----------------------------"<<std::endl;
-			log<<"GLOBAL CHANNEL No.: "<<counter.first<<std::endl;
-			log<<"Total number of events: "<<counter.second.total_counts<<std::endl;
-			log<<"Dead time incurred (only for V1724): "<<counter.second.dead_time<<std::endl;
-			log<<"Timestamp rollovers: "<<counter.second.time_roll<<std::endl;
-			log<<"Timestamp resets from external: "<<counter.second.time_reset<<std::endl;
-			log<<"Fake events: "<<counter.second.fake_event<<std::endl;
-			log<<"Memory full: "<<counter.second.mem_full<<std::endl;
-			log<<"Triggers lost: "<<counter.second.trig_lost<<std::endl;
-			log<<"N Triggers lost: "<<counter.second.n_trig_lost<<std::endl;
-			log<<"Saturation within the gate: "<<counter.second.sat_in_gate<<std::endl;
-			log<<"1024 Triggers found: "<<counter.second.trig_1024<<std::endl;
-			log<<"Saturation on input: "<<counter.second.sat_input<<std::endl;
-			log<<"N Triggers counted: "<<counter.second.n_trig_count<<std::endl;
-			log<<"Events not matched: "<<counter.second.event_not_matched<<std::endl;
-			log<<"Pile ups: "<<counter.second.pile_up<<std::endl;
-			log<<"PLL lock lost: "<<counter.second.pll_lock_loss<<std::endl;
-			log<<"Over Temperature: "<<counter.second.over_temp<<std::endl;
-			log<<"ADC Shutdown: "<<counter.second.adc_shutdown<<std::endl;
+			log<<"GLOBAL CHANNEL No.: "<<gchan<<std::endl;
+			log<<"Total number of events: "<<counts.total<<std::endl;
+			for(auto& flag : s_flagNames)
+				log<<flag.second<<": "<<counts.bitTotals[flag.first]<<std::endl;
 			log<<"-----------------------------"<<std::endl;
 		}
 	}
@@ -1,63 +1,82 @@
+/*
+	FlagHandler.h
+	Accounting of the CoMPASS hit flags. Counts are kept in a dense table indexed by global channel
+	(board#*16 + channel) with one counter per flag bit. Each hit is a branch-free add of every bit of the
+	flag word into 16-bit accumulators (which the compiler vectorizes); the accumulators are flushed to
+	64-bit totals before they can overflow. Hits with no flags set (nearly all of them) only bump the total.
+
+	Results go to the log file and, via WriteHistogram(), to the current ROOT directory.
+*/
 #ifndef FLAGHANDLER_H
 #define FLAGHANDLER_H
 
-#include <map>
+#include <array>
 
 namespace EventBuilder {
 
-	struct FlagCount 
-	{
-		long total_counts=0;
-		long dead_time=0;
-		long time_roll=0;
-		long time_reset=0;
-		long fake_event=0;
-		long mem_full=0;
-		long trig_lost=0;
-		long n_trig_lost=0;
-		long sat_in_gate=0;
-		long trig_1024=0;
-		long sat_input=0;
-		long n_trig_count=0;
-		long event_not_matched=0;
-		long fine_time=0;
-		long pile_up=0;
-		long pll_lock_loss=0;
-		long over_temp=0;
-		long adc_shutdown=0;
-	};
-	
 	class FlagHandler 
 	{
 	public:
 		FlagHandler();
 		FlagHandler(const std::string& filename);
 		~FlagHandler();
-		void CheckFlag(int board, int channel, int flag);
+
+		inline void CheckFlag(int board, int channel, int flag)
+		{
+			std::size_t gchan = channel + board*16;
+			if(gchan >= m_channels.size())
+				m_channels.resize(gchan + 1);
+
+			ChannelCounts& counts = m_channels[gchan];
+			++counts.total;
+			if(flag == 0)
+				return;
+
+			uint32_t word = flag;
+			for(int bit=0; bit<s_nBits; bit++)
+				counts.accumulator[bit] += (word >> bit) & 1u;
+			if(++counts.pending == s_flushThreshold)
+				FlushChannel(counts);
+		}
+
+		void WriteHistogram(const std::string& name = "flag_counts");
 	
-		const int DeadTime = 0x00000001;
-		const int TimeRollover = 0x00000002;
-		const int TimeReset = 0x00000004;
-		const int FakeEvent = 0x00000008;
-		const int MemFull = 0x00000010;
-		const int TrigLost = 0x00000020;
-		const int NTrigLost = 0x00000040;
-		const int SaturatingInGate = 0x00000080;
-		const int Trig1024Counted = 0x00000100;
-		const int SaturatingInput = 0x00000400;
-		const int NTrigCounted = 0x00000800;
-		const int EventNotMatched = 0x00001000;
-		const int FineTime  = 0x00004000;
-		const int PileUp = 0x00008000;
-		const int PLLLockLoss = 0x00080000;
-		const int OverTemp = 0x00100000;
-		const int ADCShutdown = 0x00200000;
+		static constexpr int DeadTime = 0x00000001;
+		static constexpr int TimeRollover = 0x00000002;
+		static constexpr int TimeReset = 0x00000004;
+		static constexpr int FakeEvent = 0x00000008;
+		static constexpr int MemFull = 0x00000010;
+		static constexpr int TrigLost = 0x00000020;
+		static constexpr int NTrigLost = 0x00000040;
+		static constexpr int SaturatingInGate = 0x00000080;
+		static constexpr int Trig1024Counted = 0x00000100;
+		static constexpr int SaturatingInput = 0x00000400;
+		static constexpr int NTrigCounted = 0x00000800;
+		static constexpr int EventNotMatched = 0x00001000;
+		static constexpr int FineTime = 0x00004000;
+		static constexpr int PileUp = 0x00008000;
+		static constexpr int PLLLockLoss = 0x00080000;
+		static constexpr int OverTemp = 0x00100000;
+		static constexpr int ADCShutdown = 0x00200000;
 	
 	private:
-		std::ofstream log;
-		std::map<int, FlagCount> event_count_map;
-	
+		static constexpr int s_nBits = 32;
+		static constexpr uint16_t s_flushThreshold = 0xFFFF; //accumulators can't overflow before this many flagged hits
+
+		struct ChannelCounts
+		{
+			uint64_t total = 0;
+			uint16_t pending = 0; //flagged hits since the last flush
+			std::array<uint16_t, s_nBits> accumulator = {};
+			std::array<uint64_t, s_nBits> bitTotals = {};
+		};
+
+		void FlushChannel(ChannelCounts& counts);
+		void FlushAll();
 		void WriteLog();
+
+		std::ofstream log;
+		std::vector<ChannelCounts> m_channels; //indexed by global channel
 	};
 
 }
@@ -0,0 +1,69 @@
+/*
+	HitEvent.cpp
+	Hit list table and CoincEvent conversion for HitEvent. See header.
+*/
+#include "HitEvent.h"
+#include "CompactEvent.h"
+
+namespace EventBuilder {
+
+	static constexpr std::size_t s_nFocalPlane = 10;
+	static constexpr std::size_t s_nSabre = sizeof(HitEvent::sabreArray)/sizeof(HitEvent::sabreArray[0]);
+	static constexpr std::size_t s_nCatrina = sizeof(HitEvent::catrinaArray)/sizeof(HitEvent::catrinaArray[0]);
+	static constexpr std::size_t s_nLists = s_nFocalPlane + 2*s_nSabre + s_nCatrina;
+
+	//Same order as the CompactEvent table
+	static HitList* GetHitListPointer(HitEvent& event, std::size_t index)
+	{
+		FPHits& fp = event.focalPlane;
+		HitList* focalPlane[s_nFocalPlane] = {
+			&fp.delayFL, &fp.delayFR, &fp.delayBL, &fp.delayBR, &fp.anodeF, &fp.anodeB,
+			&fp.scintL, &fp.scintR, &fp.cathode, &fp.monitor
+		};
+
+		if(index < s_nFocalPlane)
+			return focalPlane[index];
+		index -= s_nFocalPlane;
+		if(index < s_nSabre)
+			return &event.sabreArray[index].rings;
+		index -= s_nSabre;
+		if(index < s_nSabre)
+			return &event.sabreArray[index].wedges;
+		index -= s_nSabre;
+		if(index < s_nCatrina)
+			return &event.catrinaArray[index].catr;
+		return nullptr;
+	}
+
+	HitList& GetHitList(HitEvent& event, std::size_t index)
+	{
+		return *GetHitListPointer(event, index);
+	}
+
+	const HitList& GetHitList(const HitEvent& event, std::size_t index)
+	{
+		return *GetHitListPointer(const_cast<HitEvent&>(event), index);
+	}
+
+	void ClearHitEvent(HitEvent& event)
+	{
+		for(std::size_t i=0; i<s_nLists; i++)
+			GetHitListPointer(event, i)->clear();
+	}
+
+	void ConvertToCoincEvent(const HitEvent& event, CoincEvent& coinc)
+	{
+		for(std::size_t i=0; i<s_nLists; i++)
+			AssignHits(EventBuilder::GetHitList(coinc, i), GetHitList(event, i));
+	}
+
+	void ConvertFromCoincEvent(const CoincEvent& coinc, HitEvent& event)
+	{
+		for(std::size_t i=0; i<s_nLists; i++)
+		{
+			const std::vector<DetectorHit>& list = EventBuilder::GetHitList(coinc, i);
+			GetHitList(event, i).assign(list.data(), list.data() + list.size());
+		}
+	}
+
+}
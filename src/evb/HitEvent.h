@@ -0,0 +1,58 @@
+/*
+	HitEvent.h
+	In-memory counterpart of CoincEvent, with the same detector layout but each hit list a SmallVector. Events
+	travel through SlowSort -> FastSort -> SFPAnalyzer in this form, so building, splitting, and analyzing them
+	doesn't touch the heap for typical multiplicities. CoincEvent stays the ROOT I/O representation; the functions
+	here convert between the two when an event is written or read.
+
+	Hit lists are addressed by the same index as the CompactEvent GetHitList() table.
+*/
+#ifndef HIT_EVENT_H
+#define HIT_EVENT_H
+
+#include "DataStructs.h"
+#include "SmallVector.h"
+
+namespace EventBuilder {
+
+	using HitList = SmallVector<DetectorHit, 4>;
+
+	struct FPHits
+	{
+		HitList delayFL, delayFR, delayBL, delayBR;
+		HitList anodeF, anodeB, scintL, scintR, cathode;
+		HitList monitor;
+	};
+
+	struct SabreHits
+	{
+		HitList rings;
+		HitList wedges;
+	};
+
+	struct CatrinaHits
+	{
+		HitList catr;
+	};
+
+	struct HitEvent
+	{
+		FPHits focalPlane;
+		SabreHits sabreArray[5];
+		CatrinaHits catrinaArray[7];
+	};
+
+	HitList& GetHitList(HitEvent& event, std::size_t index);
+	const HitList& GetHitList(const HitEvent& event, std::size_t index);
+	void ClearHitEvent(HitEvent& event); //empties every list, keeping any spilled storage
+
+	void ConvertToCoincEvent(const HitEvent& event, CoincEvent& coinc);
+	void ConvertFromCoincEvent(const CoincEvent& coinc, HitEvent& event);
+
+	//Copy a hit list into a ROOT side vector, from either representation
+	inline void AssignHits(std::vector<DetectorHit>& dest, const HitList& source) { dest.assign(source.begin(), source.end()); }
+	inline void AssignHits(std::vector<DetectorHit>& dest, const std::vector<DetectorHit>& source) { dest = source; }
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+	HitReorderBuffer.cpp
+	Bounded min-heap reorder stage for merged hits. See header for details.
+*/
+#include "HitReorderBuffer.h"
+#include <algorithm>
+
+namespace EventBuilder {
+
+	//std heap functions build a max-heap, so invert the comparison to get the earliest hit on top
+	static bool IsLater(const CompassHit& a, const CompassHit& b)
+	{
+		return a.timestamp > b.timestamp;
+	}
+
+	HitReorderBuffer::HitReorderBuffer(uint64_t horizon, std::size_t capacity) :
+		m_horizon(horizon), m_capacity(capacity)
+	{
+		Reset();
+	}
+
+	HitReorderBuffer::~HitReorderBuffer() {}
+
+	void HitReorderBuffer::SetHorizon(uint64_t horizon, std::size_t capacity)
+	{
+		m_horizon = horizon;
+		m_capacity = std::max<std::size_t>(capacity, 1);
+		Reset();
+	}
+
+	void HitReorderBuffer::Reset()
+	{
+		m_heap.clear();
+		if(m_horizon > 0)
+			m_heap.reserve(m_capacity);
+		m_newestTime = 0;
+		m_lastReleased = 0;
+		m_hasReleased = false;
+		m_flushFlag = false;
+		m_lateCount = 0;
+		m_reorderedCount = 0;
+	}
+
+	bool HitReorderBuffer::Push(const CompassHit& hit)
+	{
+		if(m_hasReleased && hit.timestamp < m_lastReleased)
+		{
+			++m_lateCount;
+			return false;
+		}
+
+		if(hit.timestamp < m_newestTime)
+			++m_reorderedCount;
+		else
+			m_newestTime = hit.timestamp;
+
+		m_heap.push_back(hit);
+		std::push_heap(m_heap.begin(), m_heap.end(), IsLater);
+		return true;
+	}
+
+	bool HitReorderBuffer::Pop(CompassHit& hit)
+	{
+		if(m_heap.empty())
+			return false;
+
+		const CompassHit& earliest = m_heap.front();
+		if(!m_flushFlag && m_heap.size() < m_capacity && earliest.timestamp + m_horizon > m_newestTime)
+			return false;
+
+		std::pop_heap(m_heap.begin(), m_heap.end(), IsLater);
+		hit = std::move(m_heap.back());
+		m_heap.pop_back();
+		m_lastReleased = hit.timestamp;
+		m_hasReleased = true;
+		return true;
+	}
+
+}
@@ -0,0 +1,48 @@
+/*
+	HitReorderBuffer.h
+	Reorder stage between the file merge and the coincidence builders. The merge is only ordered if each
+	file is ordered, which is not true once shift map corrections (or board clock resets) move hits around.
+	Hits are held in a min-heap on timestamp and are only released once a hit at least one horizon later
+	has been seen, so any hit that is late by less than the horizon is put back in order. Hits later than
+	that (i.e. older than the last released hit) are counted and dropped. A capacity cap keeps the heap
+	bounded during bursts; when it is hit the earliest hit is released early.
+*/
+#ifndef HIT_REORDER_BUFFER_H
+#define HIT_REORDER_BUFFER_H
+
+#include "CompassHit.h"
+
+namespace EventBuilder {
+
+	class HitReorderBuffer
+	{
+	public:
+		HitReorderBuffer(uint64_t horizon = 0, std::size_t capacity = s_defaultCapacity);
+		~HitReorderBuffer();
+		void SetHorizon(uint64_t horizon, std::size_t capacity);
+		void Reset();
+		bool Push(const CompassHit& hit); //returns false if the hit was too late to be reordered
+		bool Pop(CompassHit& hit); //returns false if no hit is ready for release
+		inline void Flush() { m_flushFlag = true; } //release everything; call once the input is exhausted
+		inline bool IsEnabled() const { return m_horizon > 0; }
+		inline uint64_t GetHorizon() const { return m_horizon; }
+		inline uint64_t GetLateCount() const { return m_lateCount; }
+		inline uint64_t GetReorderedCount() const { return m_reorderedCount; }
+
+		static constexpr std::size_t s_defaultCapacity = 65536;
+
+	private:
+		std::vector<CompassHit> m_heap;
+		uint64_t m_horizon; //ps
+		std::size_t m_capacity;
+		uint64_t m_newestTime; //latest timestamp pushed
+		uint64_t m_lastReleased;
+		bool m_hasReleased;
+		bool m_flushFlag;
+		uint64_t m_lateCount; //hits dropped for being later than the horizon
+		uint64_t m_reorderedCount; //hits that arrived out of order but were recovered
+	};
+
+}
+
+#endif
@@ -1,9 +1,8 @@
 /*
 
-MassLookup.h
-Generates a map for isotopic masses using AMDC data; subtracts away
-electron mass from the atomic mass by default. Creates a static global instance
-of this map (MASS) for use throughout code it is included into.
+MassLookup.cpp
+Generates a table of isotopic masses using AMDC data; subtracts away
+electron mass from the atomic mass by default. See header.
 
 Written by G.W. McCann Aug. 2020
 
@@ -12,6 +11,12 @@ Written by G.W. McCann Aug. 2020
 
 namespace EventBuilder {
 	
+	MassLookup& MassLookup::GetInstance()
+	{
+		static MassLookup s_instance;
+		return s_instance;
+	}
+
 	/*
 	  Read in AMDC mass file, preformated to remove excess info. Here assumes that by default
 	  the file is in a local directory etc/
@@ -29,16 +34,17 @@ namespace EventBuilder {
 		if(massfile.is_open()) 
 		{
 			int Z,A;
-			std::string junk, element, key;
+			std::string junk, element;
 			double atomicMassBig, atomicMassSmall, isotopicMass;
 			std::getline(massfile,junk);
 			std::getline(massfile,junk);
 			while(massfile>>junk) 
 			{
 				massfile>>Z>>A>>element>>atomicMassBig>>atomicMassSmall;
+				if(Z < 0 || A <= 0)
+					continue;
 				isotopicMass = (atomicMassBig + atomicMassSmall*1e-6 - Z*electron_mass)*u_to_mev;
-				key = "("+std::to_string(Z)+","+A+")";
-				massTable[key] = isotopicMass;
+				AddMass(Z, A, isotopicMass);
 				elementTable[Z] = element;
 			}
 		} 
@@ -47,30 +53,53 @@ namespace EventBuilder {
 	}
 	
 	MassLookup::~MassLookup() {}
+
+	void MassLookup::AddMass(int Z, int A, double mass)
+	{
+		if(Z >= int(massTable.size()))
+		{
+			massTable.resize(Z+1);
+			elementTable.resize(Z+1);
+		}
+
+		MassRow& row = massTable[Z];
+		if(row.masses.empty())
+			row.minA = A;
+		else if(A < row.minA)
+		{
+			row.masses.insert(row.masses.begin(), row.minA - A, 0.0);
+			row.minA = A;
+		}
+
+		std::size_t index = A - row.minA;
+		if(index >= row.masses.size())
+			row.masses.resize(index+1, 0.0);
+		row.masses[index] = mass;
+	}
 	
 	//Returns nuclear mass in MeV
-	double MassLookup::FindMass(int Z, int A) 
+	double MassLookup::FindMass(int Z, int A) const
 	{
-		std::string key = "("+std::to_string(Z)+","+std::to_string(A)+")";
-		auto data = massTable.find(key);
-		if(data == massTable.end()) 
+		if(Z >= 0 && Z < int(massTable.size()))
 		{
-			EVB_WARN("Invalid nucleus (Z,A) ({0},{1}) at MassLookup::FindMass; returning zero.",Z,A);
-			return 0;
+			const MassRow& row = massTable[Z];
+			int index = A - row.minA;
+			if(index >= 0 && index < int(row.masses.size()) && row.masses[index] != 0.0)
+				return row.masses[index];
 		}
-		return data->second;
+		EVB_WARN("Invalid nucleus (Z,A) ({0},{1}) at MassLookup::FindMass; returning zero.",Z,A);
+		return 0;
 	}
 	
 	//returns element symbol
-	std::string MassLookup::FindSymbol(int Z, int A) 
+	std::string MassLookup::FindSymbol(int Z, int A) const
 	{
-		auto data = elementTable.find(Z);
-		if(data == elementTable.end()) 
+		if(Z < 0 || Z >= int(elementTable.size()) || elementTable[Z].empty()) 
 		{
 			EVB_WARN("Invalid nucleus (Z,A) ({0},{1}) at MassLookup::FindSymbol; returning empty string.",Z,A);
 			return "";
 		}
-		std::string fullsymbol = std::to_string(A) + data->second;
+		std::string fullsymbol = std::to_string(A) + elementTable[Z];
 		return fullsymbol;
 	}
-}
\ No newline at end of file
+}
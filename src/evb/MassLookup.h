@@ -1,9 +1,12 @@
 /*
 
 MassLookup.h
-Generates a map for isotopic masses using AMDC data; subtracts away
-electron mass from the atomic mass by default. Creates a static global instance
-of this map (MASS) for use throughout code it is included into.
+Generates a table of isotopic masses using AMDC data; subtracts away
+electron mass from the atomic mass by default. The table is loaded once,
+on first use, and shared through MassLookup::GetInstance().
+
+Masses are stored in dense per-Z rows indexed by A, so a lookup is two
+array accesses with no string building or hashing.
 
 Written by G.W. McCann Aug. 2020
 
@@ -17,23 +20,33 @@ namespace EventBuilder {
 	{
 	
 	public:
-		MassLookup();
-		~MassLookup();
-		double FindMass(int Z, int A);
-		std::string FindSymbol(int Z, int A);
+		static MassLookup& GetInstance();
+
+		double FindMass(int Z, int A) const;
+		std::string FindSymbol(int Z, int A) const;
 	
 	private:
-		std::unordered_map<std::string, double> massTable;
-		std::unordered_map<int, std::string> elementTable;
+		MassLookup();
+		~MassLookup();
+		MassLookup(const MassLookup&) = delete;
+		MassLookup& operator=(const MassLookup&) = delete;
+
+		void AddMass(int Z, int A, double mass);
+
+		struct MassRow
+		{
+			int minA = 0;
+			std::vector<double> masses; //indexed by A - minA, 0 marks an unknown isotope
+		};
+
+		std::vector<MassRow> massTable; //indexed by Z
+		std::vector<std::string> elementTable; //indexed by Z
 	
 		//constants
 		static constexpr double u_to_mev = 931.4940954;
 		static constexpr double electron_mass = 0.000548579909;
 		  
 	};
-	
-	//static instance for use throught program
-	static MassLookup MASS;
 
 }
 #endif
@@ -0,0 +1,170 @@
+/*
+	NudgeTuner.cpp
+	Parallel trial analysis of the x-average over candidate nudge values. See header.
+*/
+#include "NudgeTuner.h"
+#include <TF1.h>
+#include <TH1D.h>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace EventBuilder {
+
+	NudgeTuner::NudgeTuner(int ZT, int AT, int ZP, int AP, int ZE, int AE, double beamEnergy, double angle, double bfield, double Q) :
+		m_zfpUnit(0.0), m_bins(0)
+	{
+		ReactionMasses masses;
+		m_isValid = GetReactionMasses(ZT, AT, ZP, AP, ZE, AE, masses);
+		if(m_isValid)
+			m_zfpUnit = Delta_Z(masses, beamEnergy, angle, bfield*1000.0, 1.0, Q); //Convert kG to G
+		else
+			EVB_ERROR("Illegal mass at NudgeTuner; nudge will not be tuned.");
+	}
+
+	NudgeTuner::~NudgeTuner() {}
+
+	void NudgeTuner::AddEvent(double x1, double x2)
+	{
+		m_x1.push_back(x1);
+		m_x2.push_back(x2);
+	}
+
+	/*
+		One pass over the sample; for each event every candidate is binned. The per event work over candidates
+		is a straight loop over contiguous weights, which the compiler can vectorize. Each thread fills its own
+		table, summed at the end.
+	*/
+	std::vector<uint32_t> NudgeTuner::FillCandidates(const std::vector<double>& w1, const NudgeTuneParameters& params, int nThreads)
+	{
+		const std::size_t nCandidates = w1.size();
+		const std::size_t nEvents = m_x1.size();
+		const double xmin = params.xavgMin;
+		const int nBins = m_bins;
+		const double scale = nBins/(params.xavgMax - params.xavgMin);
+
+		std::vector<std::vector<uint32_t>> tables(nThreads);
+		auto work = [&](int t)
+		{
+			if(t != 0)
+				ThreadTopology::GetInstance().PinWorkerThread(t, m_affinity);
+			std::vector<uint32_t>& table = tables[t];
+			table.assign(nCandidates*nBins, 0); //allocated by the worker so that it is local to its node
+			std::vector<int> bins(nCandidates);
+			for(std::size_t i=nEvents*t/nThreads; i<nEvents*(t+1)/nThreads; i++)
+			{
+				const double x1 = m_x1[i], x2 = m_x2[i];
+				const double diff = x1 - x2;
+				for(std::size_t c=0; c<nCandidates; c++)
+					bins[c] = int(std::floor((x2 + w1[c]*diff - xmin)*scale)); //xavg = w1*x1 + (1-w1)*x2
+				for(std::size_t c=0; c<nCandidates; c++)
+				{
+					if(bins[c] >= 0 && bins[c] < nBins)
+						table[c*nBins + bins[c]]++;
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for(int t=1; t<nThreads; t++)
+			workers.emplace_back(work, t);
+		work(0);
+		for(auto& worker : workers)
+			worker.join();
+
+		for(int t=1; t<nThreads; t++)
+		{
+			for(std::size_t i=0; i<tables[0].size(); i++)
+				tables[0][i] += tables[t][i];
+		}
+		return tables[0];
+	}
+
+	//Fixed bin width over the window, capped so a very wide window can't exhaust memory
+	int NudgeTuner::GetNumberOfBins(const NudgeTuneParameters& params)
+	{
+		int bins = int(std::ceil((params.xavgMax - params.xavgMin)/s_binWidth));
+		return std::min(std::max(bins, 1), s_maxBins);
+	}
+
+	std::vector<NudgeTrial> NudgeTuner::Run(const NudgeTuneParameters& params, int nThreads)
+	{
+		std::vector<NudgeTrial> trials;
+		if(!m_isValid || m_x1.empty() || params.xavgMax <= params.xavgMin)
+			return trials;
+
+		const int nCandidates = std::max(params.nudge.steps, 1);
+		std::vector<double> w1(nCandidates);
+		trials.resize(nCandidates);
+		for(int c=0; c<nCandidates; c++)
+		{
+			NudgeTrial& trial = trials[c];
+			trial.nudge = params.nudge.GetValue(c);
+			double zfp = m_zfpUnit*trial.nudge;
+			trial.w1 = (Wire_Dist()/2.0 - zfp)/Wire_Dist(); //same as SFPAnalyzer::GetWeights
+			trial.w2 = 1.0 - trial.w1;
+			w1[c] = trial.w1;
+		}
+
+		if(nThreads <= 0)
+			nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		nThreads = std::max<std::size_t>(std::min<std::size_t>(nThreads, m_x1.size()), 1);
+		m_bins = GetNumberOfBins(params);
+		m_counts = FillCandidates(w1, params, nThreads);
+
+		//Fitting is cheap next to the fill; do it serially, ROOT fitting isn't thread safe
+		TF1 gaus("nudge_tune_gaus", "gaus", params.xavgMin, params.xavgMax);
+		TH1D histogram("nudge_tune_xavg", "nudge_tune_xavg", m_bins, params.xavgMin, params.xavgMax);
+		histogram.SetDirectory(nullptr);
+		for(int c=0; c<nCandidates; c++)
+		{
+			histogram.Reset();
+			for(int b=0; b<m_bins; b++)
+				histogram.SetBinContent(b+1, m_counts[c*m_bins + b]);
+			histogram.SetEntries(std::accumulate(m_counts.begin() + c*m_bins, m_counts.begin() + (c+1)*m_bins, 0.0));
+
+			gaus.SetParameters(histogram.GetMaximum(), histogram.GetBinCenter(histogram.GetMaximumBin()), histogram.GetStdDev());
+			if(histogram.GetEntries() > 0 && histogram.Fit(&gaus, "QN0R") == 0)
+				trials[c].width = std::fabs(gaus.GetParameter(2));
+			else
+				trials[c].width = -1.0;
+		}
+		return trials;
+	}
+
+	void NudgeTuner::Write(const std::vector<NudgeTrial>& trials, const NudgeTuneParameters& params, const std::string& filename)
+	{
+		if(trials.empty())
+			return;
+
+		TFile* output = TFile::Open(filename.c_str(), "RECREATE");
+		if(output == nullptr || !output->IsOpen())
+		{
+			EVB_ERROR("Unable to open nudge tuning output {0}!", filename);
+			return;
+		}
+
+		const double step = trials.size() > 1 ? trials[1].nudge - trials[0].nudge : 1.0;
+		TH1D widths("nudge_width", "xavg peak sigma vs. nudge;nudge;#sigma (mm)", trials.size(), trials.front().nudge - step/2.0,
+					trials.back().nudge + step/2.0);
+		TH2D xavg("nudge_xavg", "xavg vs. nudge;nudge;xavg (mm)", trials.size(), trials.front().nudge - step/2.0, trials.back().nudge + step/2.0,
+				  m_bins, params.xavgMin, params.xavgMax);
+		widths.SetDirectory(nullptr);
+		xavg.SetDirectory(nullptr);
+		for(std::size_t c=0; c<trials.size(); c++)
+		{
+			if(trials[c].width >= 0.0)
+				widths.SetBinContent(c+1, trials[c].width);
+			for(int b=0; b<m_bins; b++)
+				xavg.SetBinContent(c+1, b+1, m_counts[c*m_bins + b]);
+		}
+
+		output->cd();
+		widths.Write();
+		xavg.Write();
+		output->Close();
+		delete output;
+	}
+
+}
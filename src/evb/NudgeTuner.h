@@ -0,0 +1,61 @@
+/*
+	NudgeTuner.h
+	Chooses the Nudge factor by trial analysis. x1 and x2 are computed once for a sample of built events;
+	since Delta_Z is linear in the nudge, each candidate nudge just gives a new pair of weights (w1, w2) and
+	xavg = w1*x1 + w2*x2 is cheap to re-evaluate. All candidates are histogrammed in a single pass over the
+	sample (split over threads), the chosen xavg peak is fit with a gaussian for each candidate, and the
+	nudge with the narrowest peak is reported. The window must hold a single peak; it is binned at a fixed width.
+*/
+#ifndef NUDGE_TUNER_H
+#define NUDGE_TUNER_H
+
+#include "ReactionScan.h"
+#include "ThreadTopology.h"
+
+namespace EventBuilder {
+
+	struct NudgeTuneParameters
+	{
+		ScanAxis nudge = { 0.5, 1.5, 101 }; //candidate nudge values
+		double xavgMin = 0.0; //mm, window around a single peak used for the width; required
+		double xavgMax = 0.0; //mm
+		long sampleEvents = 500000; //max events with both x1 and x2 taken from the built files
+	};
+
+	struct NudgeTrial
+	{
+		double nudge;
+		double w1, w2;
+		double width; //gaussian sigma of the xavg peak (mm), < 0 if the fit failed
+	};
+
+	class NudgeTuner
+	{
+	public:
+		NudgeTuner(int ZT, int AT, int ZP, int AP, int ZE, int AE, double beamEnergy, double angle, double bfield, double Q);
+		~NudgeTuner();
+		inline bool IsValid() const { return m_isValid; }
+		void AddEvent(double x1, double x2);
+		inline std::size_t GetNumberOfEvents() const { return m_x1.size(); }
+		std::vector<NudgeTrial> Run(const NudgeTuneParameters& params, int nThreads = 0); //0 = all cores
+		inline void SetThreadAffinity(const ThreadAffinityParameters& affinity) { m_affinity = affinity; }
+		void Write(const std::vector<NudgeTrial>& trials, const NudgeTuneParameters& params, const std::string& filename);
+
+	private:
+		std::vector<uint32_t> FillCandidates(const std::vector<double>& w1, const NudgeTuneParameters& params, int nThreads);
+		static int GetNumberOfBins(const NudgeTuneParameters& params);
+
+		double m_zfpUnit; //Delta_Z at nudge 1
+		bool m_isValid;
+		std::vector<double> m_x1, m_x2;
+		std::vector<uint32_t> m_counts; //[candidate][bin], kept for Write
+		int m_bins;
+		ThreadAffinityParameters m_affinity;
+
+		static constexpr double s_binWidth = 0.1; //mm, fine next to the peak sigmas being compared
+		static constexpr int s_maxBins = 20000;
+	};
+
+}
+
+#endif
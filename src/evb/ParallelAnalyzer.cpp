@@ -0,0 +1,155 @@
+/*
+	ParallelAnalyzer.cpp
+	Chunked, order preserving parallel analysis. See header.
+*/
+#include "ParallelAnalyzer.h"
+#include <algorithm>
+
+namespace EventBuilder {
+
+	ParallelAnalyzer::ParallelAnalyzer(const SFPAnalyzer& analyzer, int nThreads, const ThreadAffinityParameters& affinity,
+									   std::size_t chunkSize) :
+		m_analyzer(analyzer), m_affinity(affinity), m_nThreads(std::max(nThreads, 1)), m_chunkSize(std::max<std::size_t>(chunkSize, 1)),
+		m_filling(nullptr), m_isStopping(false), m_contexts(m_nThreads)
+	{
+		m_maxInFlight = m_nThreads*s_chunksPerThread;
+
+		ROOT::EnableThreadSafety();
+		m_addDirectory = TH1::AddDirectoryStatus();
+		TH1::AddDirectory(false); //workers must not register histograms with a shared directory
+
+		for(int t=0; t<m_nThreads; t++)
+			m_workers.emplace_back(&ParallelAnalyzer::Work, this, t);
+		EVB_INFO("Analyzing events on {0} threads in chunks of {1}.", m_nThreads, m_chunkSize);
+	}
+
+	ParallelAnalyzer::~ParallelAnalyzer()
+	{
+		Stop();
+	}
+
+	int ParallelAnalyzer::ResolveThreads(int requested)
+	{
+		return requested > 0 ? requested : std::max<int>(std::thread::hardware_concurrency(), 1);
+	}
+
+	void ParallelAnalyzer::Submit(const HitEvent& event, const Sink& sink)
+	{
+		if(m_filling == nullptr)
+		{
+			//Wait on the oldest chunk rather than grow the pool; this is what throttles the building thread
+			if(m_free.empty() && m_chunks.size() >= m_maxInFlight)
+				EmitFront(sink);
+			if(m_free.empty())
+			{
+				m_chunks.emplace_back(new Chunk());
+				m_free.push_back(m_chunks.back().get());
+			}
+			m_filling = m_free.back();
+			m_free.pop_back();
+			m_filling->size = 0;
+		}
+
+		Chunk& chunk = *m_filling;
+		if(chunk.size < chunk.events.size())
+			chunk.events[chunk.size] = event;
+		else
+			chunk.events.push_back(event);
+		if(++chunk.size == m_chunkSize)
+			Dispatch();
+	}
+
+	void ParallelAnalyzer::Dispatch()
+	{
+		if(m_filling == nullptr)
+			return;
+
+		m_inFlight.push_back(m_filling);
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_filling->isDone = false;
+			m_queue.push_back(m_filling);
+		}
+		m_filling = nullptr;
+		m_workReady.notify_one();
+	}
+
+	void ParallelAnalyzer::EmitFront(const Sink& sink)
+	{
+		Chunk* chunk = m_inFlight.front();
+		{
+			std::unique_lock<std::mutex> guard(m_mutex);
+			m_chunkDone.wait(guard, [chunk]() { return chunk->isDone; });
+		}
+		m_inFlight.pop_front();
+
+		for(std::size_t i=0; i<chunk->size; i++)
+			sink(chunk->results[i]);
+		m_free.push_back(chunk);
+	}
+
+	void ParallelAnalyzer::Finish(const Sink& sink)
+	{
+		Dispatch();
+		while(!m_inFlight.empty())
+			EmitFront(sink);
+		Stop();
+	}
+
+	void ParallelAnalyzer::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_isStopping = true;
+		}
+		m_workReady.notify_all();
+		for(auto& worker : m_workers)
+		{
+			if(worker.joinable())
+				worker.join();
+		}
+		TH1::AddDirectory(m_addDirectory);
+	}
+
+	void ParallelAnalyzer::MergeHistograms(SFPAnalyzer& analyzer)
+	{
+		//Worker order, so the sums don't depend on scheduling
+		for(auto& context : m_contexts)
+		{
+			if(context)
+				analyzer.MergeHistograms(*context);
+		}
+	}
+
+	void ParallelAnalyzer::Work(int worker)
+	{
+		ThreadTopology::GetInstance().PinWorkerThread(worker, m_affinity); //before the context and chunk results are touched
+		m_contexts[worker].reset(new AnalysisContext(true));
+		AnalysisContext& context = *m_contexts[worker];
+
+		while(true)
+		{
+			Chunk* chunk = nullptr;
+			{
+				std::unique_lock<std::mutex> guard(m_mutex);
+				m_workReady.wait(guard, [this]() { return m_isStopping || !m_queue.empty(); });
+				if(m_queue.empty())
+					return;
+				chunk = m_queue.front();
+				m_queue.pop_front();
+			}
+
+			if(chunk->results.size() < chunk->size)
+				chunk->results.resize(chunk->size);
+			for(std::size_t i=0; i<chunk->size; i++)
+				m_analyzer.Analyze(chunk->events[i], chunk->results[i], context);
+
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				chunk->isDone = true;
+			}
+			m_chunkDone.notify_one();
+		}
+	}
+
+}
@@ -0,0 +1,84 @@
+/*
+	ParallelAnalyzer.h
+	Runs SFPAnalyzer over built events on a pool of worker threads. Events are independent once SlowSort (and
+	FastSort) have built them, so they are copied into fixed size chunks and each chunk is analyzed whole by one
+	worker, with its own AnalysisContext (histograms and PSD scratch) against the shared, read only analyzer.
+
+	Chunks are handed back in the order they were submitted: the calling thread emits a chunk to the sink only once
+	it and every chunk before it are done, so the output tree has the same event order as a serial analysis. The
+	number of chunks in flight is bounded, which holds the memory use fixed and lets the event building thread block
+	when the workers fall behind. The per-thread histograms are summed into the analyzer after Finish().
+*/
+#ifndef PARALLEL_ANALYZER_H
+#define PARALLEL_ANALYZER_H
+
+#include "SFPAnalyzer.h"
+#include "ThreadTopology.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace EventBuilder {
+
+	class ParallelAnalyzer
+	{
+	public:
+		using Sink = std::function<void(const ProcessedEvent&)>;
+
+		ParallelAnalyzer(const SFPAnalyzer& analyzer, int nThreads, const ThreadAffinityParameters& affinity,
+						 std::size_t chunkSize = s_defaultChunkSize);
+		~ParallelAnalyzer();
+
+		void Submit(const HitEvent& event, const Sink& sink); //may emit finished chunks (in order) to the sink
+		void Finish(const Sink& sink); //analyze and emit everything pending, then stop the workers
+		void MergeHistograms(SFPAnalyzer& analyzer); //after Finish()
+
+		inline int GetNumberOfThreads() const { return m_nThreads; }
+
+		static int ResolveThreads(int requested); //0 = all hardware threads
+
+		static constexpr std::size_t s_defaultChunkSize = 1024; //events per chunk; large enough to amortize the hand off
+		static constexpr std::size_t s_chunksPerThread = 2; //in flight, so a worker always has the next chunk queued
+
+	private:
+		struct Chunk
+		{
+			std::vector<HitEvent> events; //kept between uses, so their spilled hit lists are reused
+			std::vector<ProcessedEvent> results;
+			std::size_t size = 0;
+			bool isDone = false; //guarded by m_mutex
+		};
+
+		void Work(int worker);
+		void Dispatch(); //queue the chunk being filled
+		void EmitFront(const Sink& sink); //wait for the oldest chunk and emit it
+		void Stop();
+
+		const SFPAnalyzer& m_analyzer;
+		ThreadAffinityParameters m_affinity;
+		int m_nThreads;
+		std::size_t m_chunkSize;
+		std::size_t m_maxInFlight;
+
+		//Calling thread only
+		std::vector<std::unique_ptr<Chunk>> m_chunks; //owns every chunk
+		std::vector<Chunk*> m_free;
+		std::deque<Chunk*> m_inFlight; //submission order
+		Chunk* m_filling;
+
+		std::mutex m_mutex;
+		std::condition_variable m_workReady;
+		std::condition_variable m_chunkDone;
+		std::deque<Chunk*> m_queue;
+		bool m_isStopping;
+
+		std::vector<std::unique_ptr<AnalysisContext>> m_contexts; //one per worker, made on the worker
+		std::vector<std::thread> m_workers;
+		bool m_addDirectory;
+	};
+
+}
+
+#endif
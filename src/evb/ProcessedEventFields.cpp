@@ -0,0 +1,223 @@
+/*
+	ProcessedEventFields.cpp
+	Registry of the numeric ProcessedEvent fields. Offsets are measured on an instance rather than with
+	offsetof, since ProcessedEvent is not standard layout (it holds std::vectors).
+*/
+#include "ProcessedEventFields.h"
+
+namespace EventBuilder {
+
+	static std::size_t MeasureOffset(const ProcessedEvent& event, const double* member)
+	{
+		return reinterpret_cast<const char*>(member) - reinterpret_cast<const char*>(&event);
+	}
+
+	#define EVB_SCALAR_FIELD(field) { #field, MeasureOffset(ref, &ref.field), false }
+	#define EVB_ARRAY_FIELD(field, i) { #field "[" #i "]", MeasureOffset(ref, &ref.field[i]), false }
+
+	static std::vector<EventField> BuildFieldTable()
+	{
+		static const ProcessedEvent ref;
+		std::vector<EventField> fields = {
+			EVB_SCALAR_FIELD(fp1_tdiff),
+			EVB_SCALAR_FIELD(fp2_tdiff),
+			EVB_SCALAR_FIELD(fp1_tsum),
+			EVB_SCALAR_FIELD(fp2_tsum),
+			EVB_SCALAR_FIELD(fp1_tcheck),
+			EVB_SCALAR_FIELD(fp2_tcheck),
+			EVB_SCALAR_FIELD(fp1FL_tdiff_anodeFront),
+			EVB_SCALAR_FIELD(fp1FR_tdiff_anodeFront),
+			EVB_SCALAR_FIELD(fp2BL_tdiff_anodeBack),
+			EVB_SCALAR_FIELD(fp2BR_tdiff_anodeBack),
+			EVB_SCALAR_FIELD(fp1FL_tdiff_tilde),
+			EVB_SCALAR_FIELD(fp1FR_tdiff_tilde),
+			EVB_SCALAR_FIELD(fp2BL_tdiff_tilde),
+			EVB_SCALAR_FIELD(fp2BR_tdiff_tilde),
+			EVB_SCALAR_FIELD(fp1_tsum_FL),
+			EVB_SCALAR_FIELD(fp1_tsum_FR),
+			EVB_SCALAR_FIELD(fp2_tsum_BL),
+			EVB_SCALAR_FIELD(fp2_tsum_BR),
+			EVB_SCALAR_FIELD(fp1_tsumA),
+			EVB_SCALAR_FIELD(fp2_tsumB),
+			EVB_SCALAR_FIELD(fp1_y),
+			EVB_SCALAR_FIELD(fp2_y),
+			EVB_SCALAR_FIELD(anodeFront),
+			EVB_SCALAR_FIELD(anodeBack),
+			EVB_SCALAR_FIELD(scintRight),
+			EVB_SCALAR_FIELD(scintLeft),
+			EVB_SCALAR_FIELD(scintRightShort),
+			EVB_SCALAR_FIELD(scintLeftShort),
+			EVB_SCALAR_FIELD(cathode),
+			EVB_SCALAR_FIELD(xavg),
+			EVB_SCALAR_FIELD(x1),
+			EVB_SCALAR_FIELD(x2),
+			EVB_SCALAR_FIELD(x1_sum),
+			EVB_SCALAR_FIELD(x2_sum),
+			EVB_SCALAR_FIELD(x1_sumA),
+			EVB_SCALAR_FIELD(x2_sumB),
+			EVB_SCALAR_FIELD(x1FL),
+			EVB_SCALAR_FIELD(x1FR),
+			EVB_SCALAR_FIELD(x2BL),
+			EVB_SCALAR_FIELD(x2BR),
+			EVB_SCALAR_FIELD(x1FL_sum),
+			EVB_SCALAR_FIELD(x1FR_sum),
+			EVB_SCALAR_FIELD(x2BL_sum),
+			EVB_SCALAR_FIELD(x2BR_sum),
+			EVB_SCALAR_FIELD(x1tilde_FL),
+			EVB_SCALAR_FIELD(x1tilde_FR),
+			EVB_SCALAR_FIELD(x2tilde_BL),
+			EVB_SCALAR_FIELD(x2tilde_BR),
+			EVB_SCALAR_FIELD(xavg_tildeFRBL),
+			EVB_SCALAR_FIELD(xavg_tildeFLBR),
+			EVB_SCALAR_FIELD(xavg_tildeFRBR),
+			EVB_SCALAR_FIELD(xavg_tildeFLBL),
+			EVB_ARRAY_FIELD(sabreRingE, 0),
+			EVB_ARRAY_FIELD(sabreRingE, 1),
+			EVB_ARRAY_FIELD(sabreRingE, 2),
+			EVB_ARRAY_FIELD(sabreRingE, 3),
+			EVB_ARRAY_FIELD(sabreRingE, 4),
+			EVB_ARRAY_FIELD(sabreWedgeE, 0),
+			EVB_ARRAY_FIELD(sabreWedgeE, 1),
+			EVB_ARRAY_FIELD(sabreWedgeE, 2),
+			EVB_ARRAY_FIELD(sabreWedgeE, 3),
+			EVB_ARRAY_FIELD(sabreWedgeE, 4),
+			EVB_ARRAY_FIELD(sabreRingChannel, 0),
+			EVB_ARRAY_FIELD(sabreRingChannel, 1),
+			EVB_ARRAY_FIELD(sabreRingChannel, 2),
+			EVB_ARRAY_FIELD(sabreRingChannel, 3),
+			EVB_ARRAY_FIELD(sabreRingChannel, 4),
+			EVB_ARRAY_FIELD(sabreWedgeChannel, 0),
+			EVB_ARRAY_FIELD(sabreWedgeChannel, 1),
+			EVB_ARRAY_FIELD(sabreWedgeChannel, 2),
+			EVB_ARRAY_FIELD(sabreWedgeChannel, 3),
+			EVB_ARRAY_FIELD(sabreWedgeChannel, 4),
+			EVB_ARRAY_FIELD(sabreRingTime, 0),
+			EVB_ARRAY_FIELD(sabreRingTime, 1),
+			EVB_ARRAY_FIELD(sabreRingTime, 2),
+			EVB_ARRAY_FIELD(sabreRingTime, 3),
+			EVB_ARRAY_FIELD(sabreRingTime, 4),
+			EVB_ARRAY_FIELD(sabreWedgeTime, 0),
+			EVB_ARRAY_FIELD(sabreWedgeTime, 1),
+			EVB_ARRAY_FIELD(sabreWedgeTime, 2),
+			EVB_ARRAY_FIELD(sabreWedgeTime, 3),
+			EVB_ARRAY_FIELD(sabreWedgeTime, 4),
+			EVB_SCALAR_FIELD(theta),
+			EVB_SCALAR_FIELD(delayFrontRightE),
+			EVB_SCALAR_FIELD(delayFrontLeftE),
+			EVB_SCALAR_FIELD(delayBackRightE),
+			EVB_SCALAR_FIELD(delayBackLeftE),
+			EVB_SCALAR_FIELD(delayFrontRightShort),
+			EVB_SCALAR_FIELD(delayFrontLeftShort),
+			EVB_SCALAR_FIELD(delayBackRightShort),
+			EVB_SCALAR_FIELD(delayBackLeftShort),
+			EVB_SCALAR_FIELD(anodeFrontTime),
+			EVB_SCALAR_FIELD(anodeBackTime),
+			EVB_SCALAR_FIELD(scintRightTime),
+			EVB_SCALAR_FIELD(scintLeftTime),
+			EVB_SCALAR_FIELD(delayFrontMaxTime),
+			EVB_SCALAR_FIELD(delayBackMaxTime),
+			EVB_SCALAR_FIELD(delayFrontLeftTime),
+			EVB_SCALAR_FIELD(delayFrontRightTime),
+			EVB_SCALAR_FIELD(delayBackLeftTime),
+			EVB_SCALAR_FIELD(delayBackRightTime),
+			EVB_SCALAR_FIELD(cathodeTime),
+			EVB_SCALAR_FIELD(monitorE),
+			EVB_SCALAR_FIELD(monitorShort),
+			EVB_SCALAR_FIELD(monitorTime),
+			EVB_ARRAY_FIELD(catrinaE, 0),
+			EVB_ARRAY_FIELD(catrinaE, 1),
+			EVB_ARRAY_FIELD(catrinaE, 2),
+			EVB_ARRAY_FIELD(catrinaE, 3),
+			EVB_ARRAY_FIELD(catrinaE, 4),
+			EVB_ARRAY_FIELD(catrinaE, 5),
+			EVB_ARRAY_FIELD(catrinaE, 6),
+			EVB_ARRAY_FIELD(catrinaChannel, 0),
+			EVB_ARRAY_FIELD(catrinaChannel, 1),
+			EVB_ARRAY_FIELD(catrinaChannel, 2),
+			EVB_ARRAY_FIELD(catrinaChannel, 3),
+			EVB_ARRAY_FIELD(catrinaChannel, 4),
+			EVB_ARRAY_FIELD(catrinaChannel, 5),
+			EVB_ARRAY_FIELD(catrinaChannel, 6),
+			EVB_ARRAY_FIELD(catrinaTime, 0),
+			EVB_ARRAY_FIELD(catrinaTime, 1),
+			EVB_ARRAY_FIELD(catrinaTime, 2),
+			EVB_ARRAY_FIELD(catrinaTime, 3),
+			EVB_ARRAY_FIELD(catrinaTime, 4),
+			EVB_ARRAY_FIELD(catrinaTime, 5),
+			EVB_ARRAY_FIELD(catrinaTime, 6),
+			EVB_ARRAY_FIELD(catrinaShort, 0),
+			EVB_ARRAY_FIELD(catrinaShort, 1),
+			EVB_ARRAY_FIELD(catrinaShort, 2),
+			EVB_ARRAY_FIELD(catrinaShort, 3),
+			EVB_ARRAY_FIELD(catrinaShort, 4),
+			EVB_ARRAY_FIELD(catrinaShort, 5),
+			EVB_ARRAY_FIELD(catrinaShort, 6),
+			EVB_ARRAY_FIELD(catrinaPSD, 0),
+			EVB_ARRAY_FIELD(catrinaPSD, 1),
+			EVB_ARRAY_FIELD(catrinaPSD, 2),
+			EVB_ARRAY_FIELD(catrinaPSD, 3),
+			EVB_ARRAY_FIELD(catrinaPSD, 4),
+			EVB_ARRAY_FIELD(catrinaPSD, 5),
+			EVB_ARRAY_FIELD(catrinaPSD, 6),
+			EVB_ARRAY_FIELD(catrinaParticle, 0),
+			EVB_ARRAY_FIELD(catrinaParticle, 1),
+			EVB_ARRAY_FIELD(catrinaParticle, 2),
+			EVB_ARRAY_FIELD(catrinaParticle, 3),
+			EVB_ARRAY_FIELD(catrinaParticle, 4),
+			EVB_ARRAY_FIELD(catrinaParticle, 5),
+			EVB_ARRAY_FIELD(catrinaParticle, 6),
+			EVB_SCALAR_FIELD(catrinaE0),
+			EVB_SCALAR_FIELD(catrinaE1),
+			EVB_SCALAR_FIELD(catrinaE2),
+			EVB_SCALAR_FIELD(catrinaE3),
+			EVB_SCALAR_FIELD(catrinaE4),
+			EVB_SCALAR_FIELD(catrinaE5),
+			EVB_SCALAR_FIELD(catrinaE6),
+			EVB_SCALAR_FIELD(catrinaChannel0),
+			EVB_SCALAR_FIELD(catrinaChannel1),
+			EVB_SCALAR_FIELD(catrinaChannel2),
+			EVB_SCALAR_FIELD(catrinaChannel3),
+			EVB_SCALAR_FIELD(catrinaChannel4),
+			EVB_SCALAR_FIELD(catrinaChannel5),
+			EVB_SCALAR_FIELD(catrinaChannel6),
+			EVB_SCALAR_FIELD(catrinaTime0),
+			EVB_SCALAR_FIELD(catrinaTime1),
+			EVB_SCALAR_FIELD(catrinaTime2),
+			EVB_SCALAR_FIELD(catrinaTime3),
+			EVB_SCALAR_FIELD(catrinaTime4),
+			EVB_SCALAR_FIELD(catrinaTime5),
+			EVB_SCALAR_FIELD(catrinaTime6)
+		};
+
+		for(auto& field : fields)
+			field.isTime = field.name.find("Time") != std::string::npos;
+		return fields;
+	}
+
+	#undef EVB_SCALAR_FIELD
+	#undef EVB_ARRAY_FIELD
+
+	const std::vector<EventField>& GetProcessedEventFields()
+	{
+		static const std::vector<EventField> fields = BuildFieldTable();
+		return fields;
+	}
+
+	const EventField* FindProcessedEventField(const std::string& name)
+	{
+		static const std::unordered_map<std::string, std::size_t> lookup = []()
+		{
+			std::unordered_map<std::string, std::size_t> map;
+			const auto& fields = GetProcessedEventFields();
+			for(std::size_t i=0; i<fields.size(); i++)
+				map[fields[i].name] = i;
+			return map;
+		}();
+
+		auto iter = lookup.find(name);
+		if(iter == lookup.end())
+			return nullptr;
+		return &GetProcessedEventFields()[iter->second];
+	}
+
+}
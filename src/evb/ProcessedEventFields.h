@@ -0,0 +1,39 @@
+/*
+	ProcessedEventFields.h
+	Name based access to the numeric fields of ProcessedEvent. Each scalar double (and each element of the
+	fixed size arrays, named like "sabreRingE[0]") is registered once with its byte offset in the struct, so
+	that cuts, the plotter, and the columnar cache can refer to fields by name without hand maintained maps
+	and without copying events. The detector vectors (sabreArray, catrinaArray) are not numeric fields.
+
+	If a double is added to ProcessedEvent, add it to the table in ProcessedEventFields.cpp.
+*/
+#ifndef PROCESSED_EVENT_FIELDS_H
+#define PROCESSED_EVENT_FIELDS_H
+
+#include "DataStructs.h"
+
+namespace EventBuilder {
+
+	struct EventField
+	{
+		std::string name;
+		std::size_t offset; //byte offset of the double within ProcessedEvent
+		bool isTime; //absolute timestamps, which need double precision
+	};
+
+	const std::vector<EventField>& GetProcessedEventFields();
+	const EventField* FindProcessedEventField(const std::string& name);
+
+	inline double GetFieldValue(const ProcessedEvent& event, const EventField& field)
+	{
+		return *reinterpret_cast<const double*>(reinterpret_cast<const char*>(&event) + field.offset);
+	}
+
+	inline double& GetFieldReference(ProcessedEvent& event, const EventField& field)
+	{
+		return *reinterpret_cast<double*>(reinterpret_cast<char*>(&event) + field.offset);
+	}
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+	PulseShape.cpp
+	Tail/total calculation and neutron/gamma classification. See header.
+*/
+#include "PulseShape.h"
+
+namespace EventBuilder {
+
+	PulseShapeStage::PulseShapeStage(double neutronThreshold) :
+		m_neutronThreshold(neutronThreshold)
+	{
+	}
+
+	PulseShapeStage::~PulseShapeStage() {}
+
+	void PulseShapeStage::Clear()
+	{
+		m_detector.clear();
+		m_long.clear();
+		m_short.clear();
+		m_tailTotal.clear();
+		m_particle.clear();
+	}
+
+	void PulseShapeStage::AddHit(int detector, const DetectorHit& hit)
+	{
+		m_detector.push_back(detector);
+		m_long.push_back(hit.Long);
+		m_short.push_back(hit.Short);
+	}
+
+	void PulseShapeStage::Process()
+	{
+		std::size_t n = m_long.size();
+		m_tailTotal.resize(n);
+		m_particle.resize(n);
+		CalculateTailTotal(m_long.data(), m_short.data(), m_tailTotal.data(), n);
+		Classify(m_tailTotal.data(), m_neutronThreshold, m_particle.data(), n);
+	}
+
+	/*
+		The loops are written as selects rather than branches so that they vectorize. The denominator is replaced
+		for empty gates before dividing, so no lane ever divides by zero; those hits are then flagged in a second loop,
+		since GCC won't if-convert a select that depends on the division (trapping math).
+	*/
+	void PulseShapeStage::CalculateTailTotal(const double* __restrict longE, const double* __restrict shortE, double* __restrict tailTotal, std::size_t n)
+	{
+		for(std::size_t i=0; i<n; i++)
+		{
+			double denominator = longE[i] > 0.0 ? longE[i] : 1.0;
+			tailTotal[i] = (longE[i] - shortE[i])/denominator;
+		}
+		for(std::size_t i=0; i<n; i++)
+			tailTotal[i] = longE[i] > 0.0 ? tailTotal[i] : -1.0;
+	}
+
+	void PulseShapeStage::Classify(const double* __restrict tailTotal, double threshold, double* __restrict particle, std::size_t n)
+	{
+		for(std::size_t i=0; i<n; i++)
+		{
+			double isNeutron = tailTotal[i] > threshold ? 1.0 : 0.0;
+			particle[i] = tailTotal[i] < 0.0 ? -1.0 : isNeutron;
+		}
+	}
+
+}
@@ -0,0 +1,54 @@
+/*
+	PulseShape.h
+	Pulse shape discrimination for the CATRiNA liquid scintillators, from the long and short gate charges CoMPASS
+	already provides (no waveforms needed). The tail/total ratio is (Long - Short)/Long; neutrons deposit a larger
+	fraction of their light in the slow component, so hits above the threshold are classified as neutrons and the rest
+	as gammas.
+
+	Hits of an event are gathered into flat arrays and processed in one branch free loop, which the compiler
+	vectorizes. Storage is owned by the stage and reused from event to event.
+*/
+#ifndef PULSE_SHAPE_H
+#define PULSE_SHAPE_H
+
+#include "DataStructs.h"
+
+namespace EventBuilder {
+
+	class PulseShapeStage
+	{
+	public:
+		PulseShapeStage(double neutronThreshold = s_defaultNeutronThreshold);
+		~PulseShapeStage();
+
+		inline void SetNeutronThreshold(double threshold) { m_neutronThreshold = threshold; }
+		inline double GetNeutronThreshold() const { return m_neutronThreshold; }
+
+		void Clear();
+		void AddHit(int detector, const DetectorHit& hit);
+		void Process();
+
+		inline std::size_t GetNumberOfHits() const { return m_long.size(); }
+		inline int GetDetector(std::size_t i) const { return m_detector[i]; }
+		inline double GetLong(std::size_t i) const { return m_long[i]; }
+		inline double GetShort(std::size_t i) const { return m_short[i]; }
+		inline double GetTailTotal(std::size_t i) const { return m_tailTotal[i]; } //-1 if Long <= 0
+		inline double GetParticle(std::size_t i) const { return m_particle[i]; } //1 neutron, 0 gamma, -1 unclassified
+
+		static void CalculateTailTotal(const double* longE, const double* shortE, double* tailTotal, std::size_t n);
+		static void Classify(const double* tailTotal, double threshold, double* particle, std::size_t n);
+
+		static constexpr double s_defaultNeutronThreshold = 0.2; //typical organic scintillator split; tune from the PSD plot
+
+	private:
+		double m_neutronThreshold;
+		std::vector<int> m_detector;
+		std::vector<double> m_long;
+		std::vector<double> m_short;
+		std::vector<double> m_tailTotal;
+		std::vector<double> m_particle;
+	};
+
+}
+
+#endif
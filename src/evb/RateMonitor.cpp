@@ -0,0 +1,87 @@
+/*
+	RateMonitor.cpp
+	Time-binned rate monitoring filled during conversion. See header for details.
+*/
+#include "RateMonitor.h"
+#include <algorithm>
+
+namespace EventBuilder {
+
+	RateMonitor::RateMonitor(double binWidth, int nChannels, int maxMultiplicity) :
+		m_binWidth(binWidth), m_binWidthPS(binWidth*1.0e12), m_nChannels(std::max(nChannels, 1)), m_maxMultiplicity(maxMultiplicity), m_nTimeBins(0)
+	{
+		std::size_t bytesPerTimeBin = sizeof(uint32_t)*(3*m_nChannels + m_maxMultiplicity + 1);
+		m_maxTimeBins = std::max<std::size_t>(s_maxTableBytes/bytesPerTimeBin, 1);
+		if(IsEnabled())
+			Grow(64);
+	}
+
+	RateMonitor::~RateMonitor() {}
+
+	//Double the capacity each time so a long run only reallocates a handful of times
+	void RateMonitor::Grow(std::size_t nTimeBins)
+	{
+		nTimeBins = std::min(std::max(nTimeBins, 2*m_nTimeBins), m_maxTimeBins);
+		m_hits.resize(nTimeBins * m_nChannels, 0);
+		m_pileUp.resize(nTimeBins * m_nChannels, 0);
+		m_trigLost.resize(nTimeBins * m_nChannels, 0);
+		m_multiplicity.resize(nTimeBins * (m_maxMultiplicity + 1), 0);
+		m_nTimeBins = nTimeBins;
+	}
+
+	/*
+		Write the rate tables to the current directory. The time axis is trimmed to the last bin that saw a hit.
+		Channel rates are in Hz, multiplicity is in events per bin.
+	*/
+	void RateMonitor::Write()
+	{
+		if(!IsEnabled())
+			return;
+
+		//Trim the time axis to the last bin with a hit; every other table is empty past it
+		std::size_t lastBin = 0;
+		for(std::size_t i=m_hits.size(); i>0; i--)
+		{
+			if(m_hits[i-1] != 0)
+			{
+				lastBin = (i-1) / m_nChannels + 1;
+				break;
+			}
+		}
+		if(lastBin == 0)
+			return;
+
+		WriteChannelHistogram(m_hits, lastBin, "rate_hits", "hit rate");
+		WriteChannelHistogram(m_pileUp, lastBin, "rate_pileup", "pile-up rate");
+		WriteChannelHistogram(m_trigLost, lastBin, "rate_triglost", "lost trigger rate");
+
+		TH2F histo("event_multiplicity", "event multiplicity;time (s);hits in event;events", lastBin, 0.0, lastBin*m_binWidth,
+				   m_maxMultiplicity + 1, 0, m_maxMultiplicity + 1);
+		for(std::size_t i=0; i<lastBin; i++)
+		{
+			for(int m=0; m<=m_maxMultiplicity; m++)
+			{
+				uint32_t count = m_multiplicity[i * (m_maxMultiplicity + 1) + m];
+				if(count != 0)
+					histo.SetBinContent(i + 1, m + 1, count);
+			}
+		}
+		histo.Write();
+	}
+
+	void RateMonitor::WriteChannelHistogram(const std::vector<uint32_t>& table, std::size_t nTimeBins, const std::string& name, const std::string& title)
+	{
+		TH2F histo(name.c_str(), (title + ";time (s);global channel;rate (Hz)").c_str(), nTimeBins, 0.0, nTimeBins*m_binWidth, m_nChannels, 0, m_nChannels);
+		for(std::size_t i=0; i<nTimeBins; i++)
+		{
+			for(int c=0; c<m_nChannels; c++)
+			{
+				uint32_t count = table[i * m_nChannels + c];
+				if(count != 0)
+					histo.SetBinContent(i + 1, c + 1, count / m_binWidth);
+			}
+		}
+		histo.Write();
+	}
+
+}
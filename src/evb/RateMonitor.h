@@ -0,0 +1,93 @@
+/*
+	RateMonitor.h
+	Time-binned rate monitoring filled during conversion, in the same pass as the event building. Keeps per
+	global channel hit, pile-up, and lost-trigger counts per time bin, plus the built event multiplicity per
+	time bin. Counts live in flat arrays (time bin major) which are only turned into histograms at the end,
+	so filling is an index computation and an increment. The tables grow with the run, up to a fixed memory cap.
+*/
+#ifndef RATE_MONITOR_H
+#define RATE_MONITOR_H
+
+#include "CompassHit.h"
+#include "FlagHandler.h"
+
+namespace EventBuilder {
+
+	class RateMonitor
+	{
+	public:
+		RateMonitor(double binWidth, int nChannels, int maxMultiplicity = 64); //nChannels from the channel map, max global channel + 1
+		~RateMonitor();
+
+		inline bool IsEnabled() const { return m_binWidth > 0.0; }
+
+		inline void AddHit(const CompassHit& hit)
+		{
+			if(!IsEnabled())
+				return;
+
+			std::size_t gchan = hit.channel + hit.board*16;
+			if(gchan >= std::size_t(m_nChannels))
+				return;
+
+			std::size_t bin;
+			if(!FindTimeBin(hit.timestamp, bin))
+				return;
+
+			std::size_t index = bin * m_nChannels + gchan;
+			m_hits[index]++;
+			if(hit.flags & FlagHandler::PileUp)
+				m_pileUp[index]++;
+			if(hit.flags & FlagHandler::TrigLost)
+				m_trigLost[index]++;
+		}
+
+		inline void AddEvent(double time, int multiplicity)
+		{
+			if(!IsEnabled())
+				return;
+
+			std::size_t bin;
+			if(!FindTimeBin(time, bin))
+				return;
+
+			if(multiplicity > m_maxMultiplicity)
+				multiplicity = m_maxMultiplicity;
+			m_multiplicity[bin * (m_maxMultiplicity + 1) + multiplicity]++;
+		}
+
+		void Write();
+
+	private:
+		//Find the time bin, growing the tables to cover it. Times past the table limit (i.e. corrupt timestamps) are ignored.
+		inline bool FindTimeBin(double timestamp, std::size_t& bin)
+		{
+			if(timestamp >= m_maxTimeBins * m_binWidthPS)
+				return false;
+			bin = timestamp / m_binWidthPS;
+			if(bin >= m_nTimeBins)
+				Grow(bin + 1);
+			return true;
+		}
+
+		void Grow(std::size_t nTimeBins);
+		void WriteChannelHistogram(const std::vector<uint32_t>& table, std::size_t nTimeBins, const std::string& name, const std::string& title);
+
+		static constexpr std::size_t s_maxTableBytes = 256*1024*1024; //all tables together; bounds the time axis
+
+		double m_binWidth; //s
+		double m_binWidthPS;
+		int m_nChannels;
+		int m_maxMultiplicity;
+		std::size_t m_nTimeBins;
+		std::size_t m_maxTimeBins;
+
+		std::vector<uint32_t> m_hits;
+		std::vector<uint32_t> m_pileUp;
+		std::vector<uint32_t> m_trigLost;
+		std::vector<uint32_t> m_multiplicity;
+	};
+
+}
+
+#endif
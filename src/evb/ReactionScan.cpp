@@ -0,0 +1,110 @@
+/*
+	ReactionScan.cpp
+	Parallel evaluation of Delta_Z and the x-average weights over a kinematic grid. See header.
+*/
+#include "ReactionScan.h"
+#include <TParameter.h>
+#include <thread>
+#include <algorithm>
+
+namespace EventBuilder {
+
+	ReactionScan::ReactionScan(int ZT, int AT, int ZP, int AP, int ZE, int AE, double nudge) :
+		m_nudge(nudge)
+	{
+		m_isValid = GetReactionMasses(ZT, AT, ZP, AP, ZE, AE, m_masses);
+		if(!m_isValid)
+			EVB_ERROR("Illegal mass at ReactionScan; the scan will not be run.");
+	}
+
+	ReactionScan::~ReactionScan() {}
+
+	ReactionScanPoint ReactionScan::Evaluate(const ReactionMasses& masses, double nudge, double beamEnergy, double angle, double bfield, double Q)
+	{
+		ReactionScanPoint point;
+		point.beamEnergy = beamEnergy;
+		point.angle = angle;
+		point.bfield = bfield;
+		point.Q = Q;
+		point.deltaZ = Delta_Z(masses, beamEnergy, angle, bfield*1000.0, nudge, Q); //Convert kG to G
+		point.w1 = (Wire_Dist()/2.0 - point.deltaZ)/Wire_Dist(); //same as SFPAnalyzer::GetWeights
+		point.w2 = 1.0 - point.w1;
+		return point;
+	}
+
+	//Points are ordered with Q varying fastest, then B-field, angle, and beam energy
+	std::vector<ReactionScanPoint> ReactionScan::Run(const ReactionScanParameters& params, int nThreads)
+	{
+		std::vector<ReactionScanPoint> points;
+		if(!m_isValid)
+			return points;
+
+		const int nE = std::max(params.beamEnergy.steps, 1);
+		const int nA = std::max(params.angle.steps, 1);
+		const int nB = std::max(params.bfield.steps, 1);
+		const int nQ = std::max(params.Q.steps, 1);
+		const std::size_t nPoints = std::size_t(nE)*nA*nB*nQ;
+		points.resize(nPoints);
+
+		auto work = [&](std::size_t begin, std::size_t end)
+		{
+			for(std::size_t i=begin; i<end; i++)
+			{
+				std::size_t index = i;
+				int iQ = index % nQ; index /= nQ;
+				int iB = index % nB; index /= nB;
+				int iA = index % nA; index /= nA;
+				int iE = index;
+				points[i] = Evaluate(m_masses, m_nudge, params.beamEnergy.GetValue(iE), params.angle.GetValue(iA),
+									 params.bfield.GetValue(iB), params.Q.GetValue(iQ));
+			}
+		};
+
+		if(nThreads <= 0)
+			nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		nThreads = std::min<std::size_t>(nThreads, nPoints);
+
+		//Each thread gets a contiguous block of the output, so there is no sharing of results
+		std::vector<std::thread> workers;
+		std::size_t chunk = (nPoints + nThreads - 1)/nThreads;
+		for(int t=1; t<nThreads; t++)
+			workers.emplace_back(work, std::min(t*chunk, nPoints), std::min((t+1)*chunk, nPoints));
+		work(0, std::min(chunk, nPoints));
+		for(auto& worker : workers)
+			worker.join();
+
+		return points;
+	}
+
+	void ReactionScan::Write(const std::vector<ReactionScanPoint>& points, const std::string& filename)
+	{
+		TFile* output = TFile::Open(filename.c_str(), "RECREATE");
+		if(output == nullptr || !output->IsOpen())
+		{
+			EVB_ERROR("Unable to open reaction scan output {0}!", filename);
+			return;
+		}
+
+		TTree* tree = new TTree("ScanTree", "ScanTree");
+		ReactionScanPoint point;
+		tree->Branch("BeamEnergy", &point.beamEnergy);
+		tree->Branch("Theta", &point.angle);
+		tree->Branch("Bfield", &point.bfield);
+		tree->Branch("Q", &point.Q);
+		tree->Branch("DeltaZ", &point.deltaZ);
+		tree->Branch("w1", &point.w1);
+		tree->Branch("w2", &point.w2);
+		for(auto& entry : points)
+		{
+			point = entry;
+			tree->Fill();
+		}
+
+		output->cd();
+		tree->Write(tree->GetName(), TObject::kOverwrite);
+		TParameter<Double_t> nudge("Nudge", m_nudge);
+		nudge.Write();
+		output->Close();
+	}
+
+}
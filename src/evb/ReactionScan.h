@@ -0,0 +1,58 @@
+/*
+	ReactionScan.h
+	Evaluates the kinematic focal plane shift (Delta_Z) and the resulting x-average weights (w1, w2) over a
+	grid of beam energy, spectrograph angle, B-field, and excitation (the Q parameter of Delta_Z). Masses
+	are looked up once, and the grid points are split over worker threads. Useful for choosing Nudge/Q
+	without re-running the analysis.
+*/
+#ifndef REACTION_SCAN_H
+#define REACTION_SCAN_H
+
+#include "FP_kinematics.h"
+
+namespace EventBuilder {
+
+	struct ScanAxis
+	{
+		double min = 0.0;
+		double max = 0.0;
+		int steps = 0; //0 = not scanned, the nominal value from the config is used
+
+		inline double GetValue(int i) const { return steps > 1 ? min + (max - min)*i/(steps - 1) : min; }
+	};
+
+	struct ReactionScanParameters
+	{
+		ScanAxis beamEnergy; //MeV
+		ScanAxis angle; //degrees
+		ScanAxis bfield; //kG
+		ScanAxis Q; //MeV, 0 = ground state (see Delta_Z)
+	};
+
+	struct ReactionScanPoint
+	{
+		double beamEnergy, angle, bfield, Q;
+		double deltaZ; //cm
+		double w1, w2;
+	};
+
+	class ReactionScan
+	{
+	public:
+		ReactionScan(int ZT, int AT, int ZP, int AP, int ZE, int AE, double nudge);
+		~ReactionScan();
+		inline bool IsValid() const { return m_isValid; }
+		std::vector<ReactionScanPoint> Run(const ReactionScanParameters& params, int nThreads = 0); //0 = all cores
+		void Write(const std::vector<ReactionScanPoint>& points, const std::string& filename);
+
+		static ReactionScanPoint Evaluate(const ReactionMasses& masses, double nudge, double beamEnergy, double angle, double bfield, double Q);
+
+	private:
+		ReactionMasses m_masses;
+		double m_nudge;
+		bool m_isValid;
+	};
+
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*
+	Reanalyzer.cpp
+	Parallel re-analysis of built files. See header.
+*/
+#include "Reanalyzer.h"
+#include "BuiltFileReader.h"
+#include "SFPAnalyzer.h"
+#include "ThreadTopology.h"
+#include <TKey.h>
+#include <TParameter.h>
+#include <thread>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+namespace EventBuilder {
+
+	Reanalyzer::Reanalyzer(const EVBParameters& params) :
+		m_params(params), m_progressFraction(0.1), m_processed(0), m_finishedWorkers(0)
+	{
+	}
+
+	Reanalyzer::~Reanalyzer() {}
+
+	bool Reanalyzer::Run(const std::string& builtFile, const std::string& analyzedFile)
+	{
+		Long64_t nentries = 0;
+		{
+			BuiltFileReader reader;
+			if(!reader.Open(builtFile))
+				return false;
+			nentries = reader.GetEntries();
+		}
+
+		int nThreads = m_params.analysisThreads > 0 ? m_params.analysisThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		nThreads = std::max<Long64_t>(std::min<Long64_t>(nThreads, nentries), 1);
+
+		ROOT::EnableThreadSafety();
+		bool addDirectory = TH1::AddDirectoryStatus();
+		TH1::AddDirectory(false); //analyzer histograms must not be owned by the per-thread part files
+
+		m_processed = 0;
+		m_finishedWorkers = 0;
+
+		TFile* output = TFile::Open(analyzedFile.c_str(), "RECREATE");
+		if(output == nullptr || !output->IsOpen())
+		{
+			EVB_ERROR("Unable to open output file {0} at Reanalyzer::Run()", analyzedFile);
+			delete output;
+			TH1::AddDirectory(addDirectory);
+			return false;
+		}
+
+		//One analyzer shared read only by every thread; each thread has its own context, and so its own histograms
+		SFPAnalyzer analyzer(m_params.ZT, m_params.AT, m_params.ZP, m_params.AP, m_params.ZE, m_params.AE, m_params.beamEnergy,
+							 m_params.spsAngle, m_params.BField, m_params.nudge, m_params.Q);
+		analyzer.SetPSDThreshold(m_params.catrinaPSDThreshold);
+		//A single thread writes straight into the output; several write part files that are merged afterwards
+		std::vector<std::unique_ptr<AnalysisContext>> contexts;
+		std::vector<std::string> partFiles;
+		for(int t=0; t<nThreads; t++)
+		{
+			contexts.emplace_back(new AnalysisContext(true));
+			if(nThreads > 1)
+				partFiles.push_back(analyzedFile + ".part" + std::to_string(t));
+		}
+
+		EVB_INFO("Reanalyzing {0} events from {1} on {2} threads...", nentries, builtFile, nThreads);
+		std::vector<uint8_t> succeeded(nThreads, 0);
+		std::vector<std::thread> workers;
+		for(int t=0; t<nThreads; t++)
+		{
+			Long64_t begin = nentries*t/nThreads;
+			Long64_t end = nentries*(t+1)/nThreads;
+			workers.emplace_back([&, t, begin, end]()
+			{
+				ThreadTopology::GetInstance().PinWorkerThread(t, m_params.affinityParams); //before the reader and tree buffers are allocated
+				if(partFiles.empty())
+					succeeded[t] = AnalyzeRange(analyzer, *contexts[t], builtFile, output, begin, end);
+				else
+				{
+					TFile* part = TFile::Open(partFiles[t].c_str(), "RECREATE");
+					if(part == nullptr || !part->IsOpen())
+						EVB_ERROR("Unable to open part file {0} at Reanalyzer::Run()", partFiles[t]);
+					else
+					{
+						succeeded[t] = AnalyzeRange(analyzer, *contexts[t], builtFile, part, begin, end);
+						part->Close();
+					}
+					delete part;
+				}
+				++m_finishedWorkers;
+			});
+		}
+
+		//Progress is reported from this thread only; the callback may drive the GUI, which is not thread safe
+		long flush = std::max<long>(nentries*m_progressFraction, 1);
+		long nextReport = flush;
+		while(m_finishedWorkers < nThreads)
+		{
+			std::this_thread::sleep_for(s_progressPollInterval);
+			long processed = m_processed;
+			if(processed >= nextReport)
+			{
+				m_progressCallback(processed, nentries);
+				nextReport = (processed/flush + 1)*flush;
+			}
+		}
+		for(auto& worker : workers)
+			worker.join();
+		TH1::AddDirectory(addDirectory); //the merged histograms below belong to the output file, as in a serial analysis
+
+		bool isValid = std::all_of(succeeded.begin(), succeeded.end(), [](uint8_t flag) { return flag != 0; });
+		if(isValid && !partFiles.empty())
+		{
+			//Parts are chained in thread order, which is entry order
+			TChain chain("SPSTree");
+			for(auto& part : partFiles)
+				chain.Add(part.c_str());
+			chain.Merge(output, 0, "fast keep");
+		}
+		if(isValid)
+		{
+
+			//Sum the per-thread histograms into the analyzer, in thread order
+			output->cd();
+			for(auto& context : contexts)
+				analyzer.MergeHistograms(*context);
+
+			CopyRunObjects(builtFile, output);
+			WriteParameters();
+			analyzer.GetHashTable()->Write();
+		}
+		else
+			EVB_ERROR("Reanalysis of {0} failed; {1} is incomplete and has been removed.", builtFile, analyzedFile);
+		output->Close();
+		delete output;
+
+		std::error_code ec;
+		for(auto& part : partFiles)
+			std::filesystem::remove(part, ec);
+		if(!isValid)
+			std::filesystem::remove(analyzedFile, ec);
+
+		return isValid;
+	}
+
+	//Analyzes [begin, end) into an SPSTree in output; the caller owns and closes the file
+	bool Reanalyzer::AnalyzeRange(const SFPAnalyzer& analyzer, AnalysisContext& context, const std::string& builtFile, TFile* output,
+								  Long64_t begin, Long64_t end)
+	{
+		BuiltFileReader reader;
+		if(!reader.Open(builtFile))
+		{
+			EVB_ERROR("Unable to open built file {0} at Reanalyzer::AnalyzeRange()", builtFile);
+			return false;
+		}
+
+		output->cd();
+		TTree* outtree = new TTree("SPSTree", "SPSTree");
+		ProcessedEvent pevent;
+		outtree->Branch("event", &pevent);
+
+		CoincEvent event;
+		long pending = 0; //published in batches, so the workers don't all contend for the shared counter
+		for(Long64_t i=begin; i<end; i++)
+		{
+			event = reader.GetEntry(i);
+			analyzer.Analyze(event, pevent, context);
+			outtree->Fill();
+			if(++pending == s_progressBatch)
+			{
+				m_processed += pending;
+				pending = 0;
+			}
+		}
+		m_processed += pending;
+
+		output->cd();
+		outtree->Write(outtree->GetName(), TObject::kOverwrite);
+		return true;
+	}
+
+	//Scalers, sort statistics and the like are properties of the run, not the analysis; carry them over as is
+	void Reanalyzer::CopyRunObjects(const std::string& builtFile, TFile* output)
+	{
+		TFile* input = TFile::Open(builtFile.c_str(), "READ");
+		if(input == nullptr || !input->IsOpen())
+			return;
+
+		TIter next(input->GetListOfKeys());
+		while(TKey* key = (TKey*) next())
+		{
+			if(std::string(key->GetName()) == "SortTree")
+				continue;
+			TObject* object = key->ReadObj();
+			output->cd();
+			object->Write(key->GetName(), TObject::kOverwrite);
+			delete object;
+		}
+		input->Close();
+		delete input;
+		output->cd();
+	}
+
+	void Reanalyzer::WriteParameters()
+	{
+		std::vector<TParameter<Double_t>> parvec;
+		parvec.reserve(11);
+		parvec.emplace_back("ZT", m_params.ZT);
+		parvec.emplace_back("AT", m_params.AT);
+		parvec.emplace_back("ZP", m_params.ZP);
+		parvec.emplace_back("AP", m_params.AP);
+		parvec.emplace_back("ZE", m_params.ZE);
+		parvec.emplace_back("AE", m_params.AE);
+		parvec.emplace_back("Bfield", m_params.BField);
+		parvec.emplace_back("BeamKE", m_params.beamEnergy);
+		parvec.emplace_back("Theta", m_params.spsAngle);
+		parvec.emplace_back("Nudge", m_params.nudge);
+		parvec.emplace_back("Q", m_params.Q);
+
+		for(auto& entry : parvec)
+			entry.Write();
+	}
+
+}
@@ -0,0 +1,50 @@
+/*
+	Reanalyzer.h
+	Re-runs SFPAnalyzer over an existing built file (SortTree, full or compact) to produce an analyzed file,
+	so that kinematic parameters (Nudge, Q, B-field, angle, beam energy) can be changed without unpacking and
+	re-sorting the raw data. The entries are split into contiguous ranges, one per thread; each thread has its
+	own reader and analysis context (the analyzer itself is shared) and writes a part file. The parts are then
+	merged in order, so the analyzed tree has the same event order as the built tree. A single thread writes
+	straight into the analyzed file.
+*/
+#ifndef REANALYZER_H
+#define REANALYZER_H
+
+#include "EVBParameters.h"
+#include "ProgressCallback.h"
+#include <atomic>
+#include <chrono>
+
+namespace EventBuilder {
+
+	class SFPAnalyzer;
+	struct AnalysisContext;
+
+	class Reanalyzer
+	{
+	public:
+		Reanalyzer(const EVBParameters& params);
+		~Reanalyzer();
+		bool Run(const std::string& builtFile, const std::string& analyzedFile);
+		inline void SetProgressCallbackFunc(const ProgressCallbackFunc& function) { m_progressCallback = function; }
+		inline void SetProgressFraction(double frac) { m_progressFraction = frac; }
+
+	private:
+		bool AnalyzeRange(const SFPAnalyzer& analyzer, AnalysisContext& context, const std::string& builtFile, TFile* output,
+						  Long64_t begin, Long64_t end);
+		void CopyRunObjects(const std::string& builtFile, TFile* output);
+		void WriteParameters();
+
+		EVBParameters m_params;
+		ProgressCallbackFunc m_progressCallback;
+		double m_progressFraction;
+		std::atomic<long> m_processed; //updated by the workers, reported by the calling thread
+		std::atomic<int> m_finishedWorkers;
+
+		static constexpr std::chrono::milliseconds s_progressPollInterval = std::chrono::milliseconds(100);
+		static constexpr long s_progressBatch = 4096; //entries a worker analyzes between updates of m_processed
+	};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+	RingBuffer.h
+	Fixed capacity FIFO over a single preallocated vector. Used to hold hits while an event is being
+	built, so that memory use is fixed up front and opening/closing windows never (re)allocates.
+	Capacity is rounded up to a power of two so that indexing is a mask rather than a modulo.
+	Pushing to a full buffer fails; it is up to the owner to decide what to do with the hit.
+*/
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+namespace EventBuilder {
+
+	template<typename T>
+	class RingBuffer
+	{
+	public:
+		RingBuffer(std::size_t capacity) :
+			m_head(0), m_size(0)
+		{
+			std::size_t realCapacity = 1;
+			while(realCapacity < capacity)
+				realCapacity <<= 1;
+			m_data.resize(realCapacity);
+			m_mask = realCapacity - 1;
+		}
+
+		~RingBuffer() {}
+
+		inline bool PushBack(const T& value)
+		{
+			if(IsFull())
+				return false;
+			m_data[(m_head + m_size) & m_mask] = value;
+			++m_size;
+			return true;
+		}
+
+		inline void PopFront()
+		{
+			if(m_size == 0)
+				return;
+			m_head = (m_head + 1) & m_mask;
+			--m_size;
+		}
+
+		//Drop the first n elements
+		inline void PopFront(std::size_t n)
+		{
+			if(n > m_size)
+				n = m_size;
+			m_head = (m_head + n) & m_mask;
+			m_size -= n;
+		}
+
+		inline void Clear() { m_head = 0; m_size = 0; }
+
+		inline T& operator[](std::size_t i) { return m_data[(m_head + i) & m_mask]; }
+		inline const T& operator[](std::size_t i) const { return m_data[(m_head + i) & m_mask]; }
+		inline T& Front() { return m_data[m_head]; }
+		inline T& Back() { return m_data[(m_head + m_size - 1) & m_mask]; }
+
+		inline std::size_t Size() const { return m_size; }
+		inline std::size_t Capacity() const { return m_data.size(); }
+		inline bool IsEmpty() const { return m_size == 0; }
+		inline bool IsFull() const { return m_size == m_data.size(); }
+
+	private:
+		std::vector<T> m_data;
+		std::size_t m_mask;
+		std::size_t m_head;
+		std::size_t m_size;
+	};
+
+}
+
+#endif
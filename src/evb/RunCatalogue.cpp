@@ -0,0 +1,233 @@
+/*
+	RunCatalogue.cpp
+	Incrementally refreshed index of workspace run files. See header.
+*/
+#include "RunCatalogue.h"
+#include <filesystem>
+#include <sstream>
+
+namespace EventBuilder {
+
+	static int64_t GetModTime(const std::filesystem::path& path, std::error_code& ec)
+	{
+		return std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+	}
+
+	RunCatalogue::RunCatalogue() :
+		m_isModified(false)
+	{
+	}
+
+	RunCatalogue::~RunCatalogue() {}
+
+	void RunCatalogue::AddStage(RunStage runStage, const std::string& directory, const std::string& prefix, const std::string& extension)
+	{
+		Stage& stage = GetStage(runStage);
+		stage.directory = directory;
+		stage.prefix = prefix;
+		stage.extension = extension;
+		stage.isScanned = false;
+		stage.runs.clear();
+	}
+
+	/*
+		File format:
+		EVBRunCatalogue 2
+		stage <index> <directory time>
+		run <stage index> <run> <size> <mod time> <fingerprint> <path>
+		A stage whose directory has changed since is rescanned on first use.
+	*/
+	bool RunCatalogue::Load(const std::string& filename)
+	{
+		std::ifstream input(filename);
+		if(!input.is_open())
+			return false;
+
+		std::string line, keyword;
+		std::getline(input, line);
+		if(line != "EVBRunCatalogue 2")
+		{
+			EVB_WARN("Run catalogue {0} has an unknown format; it will be rebuilt.", filename);
+			return false;
+		}
+
+		while(std::getline(input, line))
+		{
+			std::stringstream stream(line);
+			stream >> keyword;
+			if(keyword == "stage")
+			{
+				std::size_t index;
+				int64_t directoryTime;
+				stream >> index >> directoryTime;
+				if(!stream || index >= m_stages.size())
+					continue;
+				Stage& stage = m_stages[index];
+				std::error_code ec;
+				if(!stage.directory.empty() && GetModTime(stage.directory, ec) == directoryTime && !ec)
+				{
+					stage.directoryTime = directoryTime;
+					stage.isScanned = true;
+				}
+			}
+			else if(keyword == "run")
+			{
+				std::size_t index;
+				int run;
+				RunFileInfo info;
+				stream >> index >> run >> info.size >> info.modTime >> info.fingerprint;
+				if(!stream || index >= m_stages.size())
+					continue;
+				stream.ignore(1);
+				std::getline(stream, info.path);
+				m_stages[index].runs[run] = info;
+			}
+		}
+		m_isModified = false;
+		return true;
+	}
+
+	//Written to a temporary file and moved into place, so a reader never sees a partial catalogue
+	bool RunCatalogue::Save(const std::string& filename)
+	{
+		std::string tempname = filename + ".tmp";
+		{
+			std::ofstream output(tempname);
+			if(!output.is_open())
+			{
+				EVB_WARN("Unable to write run catalogue {0}.", filename);
+				return false;
+			}
+			output << "EVBRunCatalogue 2\n";
+			for(std::size_t i=0; i<m_stages.size(); i++)
+			{
+				const Stage& stage = m_stages[i];
+				if(!stage.isScanned)
+					continue;
+				output << "stage " << i << " " << stage.directoryTime << "\n";
+				for(auto& [run, info] : stage.runs)
+					output << "run " << i << " " << run << " " << info.size << " " << info.modTime << " " << info.fingerprint << " " << info.path << "\n";
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempname, filename, ec);
+		if(ec)
+		{
+			EVB_WARN("Unable to write run catalogue {0}: {1}", filename, ec.message());
+			return false;
+		}
+		m_isModified = false;
+		return true;
+	}
+
+	bool RunCatalogue::ParseRunNumber(const Stage& stage, const std::string& filename, int& run) const
+	{
+		if(filename.size() <= stage.prefix.size() + stage.extension.size() || filename.compare(0, stage.prefix.size(), stage.prefix) != 0 ||
+		   filename.compare(filename.size() - stage.extension.size(), stage.extension.size(), stage.extension) != 0)
+			return false;
+
+		std::string number = filename.substr(stage.prefix.size(), filename.size() - stage.prefix.size() - stage.extension.size());
+		if(number.empty() || number.size() > 9 || number.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		run = std::stoi(number);
+		return true;
+	}
+
+	uint64_t RunCatalogue::MakeFingerprint(const std::string& path, uint64_t size, int64_t modTime)
+	{
+		//FNV-1a over the path, size, and modification time
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](const void* data, std::size_t length)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for(std::size_t i=0; i<length; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		mix(path.data(), path.size());
+		mix(&size, sizeof(size));
+		mix(&modTime, sizeof(modTime));
+		return hash;
+	}
+
+	//Rescan only if files were added, removed, or renamed
+	void RunCatalogue::ScanIfChanged(Stage& stage)
+	{
+		std::error_code ec;
+		int64_t directoryTime = GetModTime(stage.directory, ec);
+		if(ec || (stage.isScanned && directoryTime == stage.directoryTime))
+			return;
+
+		std::map<int, RunFileInfo> runs;
+		for(auto& entry : std::filesystem::directory_iterator(stage.directory, ec))
+		{
+			int run;
+			if(!entry.is_regular_file(ec) || !ParseRunNumber(stage, entry.path().filename().string(), run))
+				continue;
+
+			RunFileInfo info;
+			info.path = entry.path().string();
+			info.size = entry.file_size(ec);
+			info.modTime = GetModTime(entry.path(), ec);
+			info.fingerprint = MakeFingerprint(info.path, info.size, info.modTime);
+			runs[run] = info;
+		}
+
+		stage.runs.swap(runs);
+		stage.directoryTime = directoryTime;
+		stage.isScanned = true;
+		m_isModified = true;
+	}
+
+	//A file rewritten in place doesn't touch the directory time, so a returned file is always stat'ed
+	bool RunCatalogue::Validate(Stage& stage, std::map<int, RunFileInfo>::iterator& iter)
+	{
+		RunFileInfo& info = iter->second;
+		std::error_code ec;
+		uint64_t size = std::filesystem::file_size(info.path, ec);
+		if(ec)
+		{
+			stage.runs.erase(iter);
+			m_isModified = true;
+			return false;
+		}
+		int64_t modTime = GetModTime(info.path, ec);
+		if(size != info.size || modTime != info.modTime)
+		{
+			info.size = size;
+			info.modTime = modTime;
+			info.fingerprint = MakeFingerprint(info.path, size, modTime);
+			m_isModified = true;
+		}
+		return true;
+	}
+
+	const RunFileInfo* RunCatalogue::FindRun(RunStage runStage, int run)
+	{
+		Stage& stage = GetStage(runStage);
+		ScanIfChanged(stage);
+		auto iter = stage.runs.find(run);
+		if(iter == stage.runs.end() || !Validate(stage, iter))
+			return nullptr;
+		return &iter->second;
+	}
+
+	std::vector<std::string> RunCatalogue::GetRunRange(RunStage runStage, int runMin, int runMax)
+	{
+		std::vector<std::string> list;
+		Stage& stage = GetStage(runStage);
+		ScanIfChanged(stage);
+		auto iter = stage.runs.lower_bound(runMin);
+		while(iter != stage.runs.end() && iter->first <= runMax)
+		{
+			auto current = iter++;
+			if(Validate(stage, current))
+				list.push_back(current->second.path);
+		}
+		return list;
+	}
+
+}
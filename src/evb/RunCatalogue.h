@@ -0,0 +1,72 @@
+/*
+	RunCatalogue.h
+	Index of the run files in the workspace, by run number and stage. Each stage directory is only scanned when its
+	modification time changes (a file was added, removed, or renamed); otherwise a lookup stats just the one file it
+	returns, to catch files rewritten in place. Runs are held in ordered maps, so ranges are a single walk rather than
+	a directory scan per run.
+
+	Per file the catalogue keeps the size, modification time, and a fingerprint of those. It is saved in the
+	workspace so that the next invocation starts warm.
+*/
+#ifndef RUN_CATALOGUE_H
+#define RUN_CATALOGUE_H
+
+#include <map>
+#include <array>
+
+namespace EventBuilder {
+
+	enum class RunStage
+	{
+		Raw, //raw_binary/run_N.tar.gz
+		Sorted, //sorted/compass_run_N.root
+		Built, //built/run_N.root
+		Analyzed //analyzed/run_N.root
+	};
+
+	struct RunFileInfo
+	{
+		std::string path;
+		uint64_t size = 0; //bytes
+		int64_t modTime = 0; //filesystem clock ticks
+		uint64_t fingerprint = 0; //changes whenever the file is rewritten
+	};
+
+	class RunCatalogue
+	{
+	public:
+		RunCatalogue();
+		~RunCatalogue();
+
+		void AddStage(RunStage stage, const std::string& directory, const std::string& prefix, const std::string& extension);
+		bool Load(const std::string& filename);
+		bool Save(const std::string& filename);
+		inline bool IsModified() const { return m_isModified; }
+
+		const RunFileInfo* FindRun(RunStage stage, int run); //nullptr if the run has no file at this stage
+		std::vector<std::string> GetRunRange(RunStage stage, int runMin, int runMax);
+
+	private:
+		struct Stage
+		{
+			std::string directory;
+			std::string prefix;
+			std::string extension;
+			int64_t directoryTime = 0;
+			bool isScanned = false;
+			std::map<int, RunFileInfo> runs;
+		};
+
+		Stage& GetStage(RunStage stage) { return m_stages[static_cast<std::size_t>(stage)]; }
+		void ScanIfChanged(Stage& stage);
+		bool Validate(Stage& stage, std::map<int, RunFileInfo>::iterator& iter);
+		bool ParseRunNumber(const Stage& stage, const std::string& filename, int& run) const;
+		static uint64_t MakeFingerprint(const std::string& path, uint64_t size, int64_t modTime);
+
+		std::array<Stage, 4> m_stages;
+		bool m_isModified;
+	};
+
+}
+
+#endif
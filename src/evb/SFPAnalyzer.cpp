@@ -20,31 +20,57 @@ Heavily modified by J. Esparza 2024/2025 to include plane reconstruction, focal
 
 namespace EventBuilder {
 
+	//ProcessedEvent keeps per-detector CATRiNA scalars alongside the arrays, for easy tree drawing
+	static double ProcessedEvent::* const s_catrinaEScalars[] = {
+		&ProcessedEvent::catrinaE0, &ProcessedEvent::catrinaE1, &ProcessedEvent::catrinaE2, &ProcessedEvent::catrinaE3,
+		&ProcessedEvent::catrinaE4, &ProcessedEvent::catrinaE5, &ProcessedEvent::catrinaE6
+	};
+	static double ProcessedEvent::* const s_catrinaChannelScalars[] = {
+		&ProcessedEvent::catrinaChannel0, &ProcessedEvent::catrinaChannel1, &ProcessedEvent::catrinaChannel2, &ProcessedEvent::catrinaChannel3,
+		&ProcessedEvent::catrinaChannel4, &ProcessedEvent::catrinaChannel5, &ProcessedEvent::catrinaChannel6
+	};
+	static double ProcessedEvent::* const s_catrinaTimeScalars[] = {
+		&ProcessedEvent::catrinaTime0, &ProcessedEvent::catrinaTime1, &ProcessedEvent::catrinaTime2, &ProcessedEvent::catrinaTime3,
+		&ProcessedEvent::catrinaTime4, &ProcessedEvent::catrinaTime5, &ProcessedEvent::catrinaTime6
+	};
+	static const std::string s_catrinaPSDNames[] = {
+		"catrina0 PSD", "catrina1 PSD", "catrina2 PSD", "catrina3 PSD", "catrina4 PSD", "catrina5 PSD", "catrina6 PSD"
+	};
+	static const std::string s_catrinaTailTotalNames[] = {
+		"catrina0 tail/total", "catrina1 tail/total", "catrina2 tail/total", "catrina3 tail/total", "catrina4 tail/total",
+		"catrina5 tail/total", "catrina6 tail/total"
+	};
+
+	static const ProcessedEvent s_blank; //output set back to "zero" before each event
+
+	AnalysisContext::AnalysisContext(bool detach) :
+		histograms(new THashTable()), detachHistograms(detach)
+	{
+	}
+
+	AnalysisContext::~AnalysisContext()
+	{
+		if(detachHistograms)
+			histograms->Delete();
+		else
+			histograms->Clear(); //attached histograms belong to their directory
+		delete histograms;
+	}
+
 	/*Constructor takes in kinematic parameters for generating focal plane weights*/
 	SFPAnalyzer::SFPAnalyzer(int zt, int at, int zp, int ap, int ze, int ae, double ep,
-								double angle, double b, double nudge, double Q) 
+								double angle, double b, double nudge, double Q) :
+		m_psdThreshold(PulseShapeStage::s_defaultNeutronThreshold)
 	{
 		zfp = Delta_Z(zt, at, zp, ap, ze, ae, ep, angle, b*1000.0, nudge, Q); //Convert kG to G
 		//EVB_INFO("Nudge factor and Q value are {0} and {1} respectively",nudge,Q);
 		EVB_INFO("the kinematic inputs are: zt={0}, at={1}, zp={2}, ap={3}, ze={4}, ae={5}, ep={6}, angle={7}, b={8}, nudge={9}, and Q={10}",
 					zt,at,zp,ap,ze,ae,ep,angle,b,nudge,Q);
 		EVB_INFO("Focal plane shift is {0} cm",zfp);
-		event_address = new CoincEvent();
-		rootObj = new THashTable();
 		GetWeights();
 	}
 	
-	SFPAnalyzer::~SFPAnalyzer() 
-	{
-		rootObj->Clear();
-		delete rootObj;
-		delete event_address;
-	}
-	
-	void SFPAnalyzer::Reset() 
-	{
-		pevent = blank; //set output back to blank
-	}
+	SFPAnalyzer::~SFPAnalyzer() {}
 	
 	/*Use functions from FP_kinematics to calculate weights for xavg
 	 *While this seems kind of funny, it is mathematically equivalent to making a line
@@ -59,39 +85,57 @@ namespace EventBuilder {
 	}
 	
 	/*2D histogram fill wrapper for use with THashTable (faster)*/
-	void SFPAnalyzer::MyFill(const std::string& name, int binsx, double minx, double maxx, double valuex,
+	void SFPAnalyzer::MyFill(AnalysisContext& context, const std::string& name, int binsx, double minx, double maxx, double valuex,
 								int binsy, double miny, double maxy, double valuey) 
 	{
-		TH2F *histo = (TH2F*) rootObj->FindObject(name.c_str());
+		TH2F *histo = (TH2F*) context.histograms->FindObject(name.c_str());
 		if(histo != nullptr) 
 			histo->Fill(valuex, valuey);
 		else 
 		{
 			TH2F *h = new TH2F(name.c_str(), name.c_str(), binsx, minx, maxx, binsy, miny, maxy);
+			if(context.detachHistograms)
+				h->SetDirectory(nullptr);
 			h->Fill(valuex, valuey);
-			rootObj->Add(h);
+			context.histograms->Add(h);
 		}
 	}
 	
 	/*1D histogram fill wrapper for use with THashTable (faster)*/
-	void SFPAnalyzer::MyFill(const std::string& name, int binsx, double minx, double maxx, double valuex)
+	void SFPAnalyzer::MyFill(AnalysisContext& context, const std::string& name, int binsx, double minx, double maxx, double valuex)
 	{
-		TH1F *histo = (TH1F*) rootObj->FindObject(name.c_str());
+		TH1F *histo = (TH1F*) context.histograms->FindObject(name.c_str());
 		if(histo != nullptr)
 			histo->Fill(valuex);
 		else 
 		{
 			TH1F *h = new TH1F(name.c_str(), name.c_str(), binsx, minx, maxx);
+			if(context.detachHistograms)
+				h->SetDirectory(nullptr);
 			h->Fill(valuex);
-			rootObj->Add(h);
+			context.histograms->Add(h);
+		}
+	}
+
+	/*Worker histograms are cloned rather than moved, so the worker context can always delete its own*/
+	void SFPAnalyzer::MergeHistograms(const AnalysisContext& context)
+	{
+		TIter next(context.histograms);
+		while(TObject* object = next())
+		{
+			TH1* total = (TH1*) m_context.histograms->FindObject(object->GetName());
+			if(total != nullptr)
+				total->Add((TH1*) object);
+			else
+				m_context.histograms->Add(object->Clone());
 		}
 	}
 	
-	void SFPAnalyzer::AnalyzeEvent(CoincEvent& event) 
+	//Written against the shared list interface, so it serves both CoincEvent (read from file) and HitEvent (in memory)
+	template<typename Event>
+	void SFPAnalyzer::Analyze(const Event& event, ProcessedEvent& pevent, AnalysisContext& context) const
 	{
-		//Set the address of the event to be analyzed. 
-
-		Reset();
+		pevent = s_blank;
 
 		// anodes 
 		if(!event.focalPlane.anodeF.empty()) 
@@ -174,10 +218,10 @@ namespace EventBuilder {
 			pevent.x1_sum = pevent.fp1_tsum; // testing JCE 2025
 
 
-			MyFill("x1",1200,-600,600,pevent.x1);
+			MyFill(context, "x1",1200,-600,600,pevent.x1);
 			//MyFill("x1_tsum",512,0,16000,pevent.x1_sum);
-			MyFill("x1 vs tsum scint",600,-300,300,pevent.x1,512,0,16000,pevent.fp1_tsum);
-			MyFill("x1 vs anodeBack",600,-300,300,pevent.x1,512,0,4096,pevent.anodeBack);
+			MyFill(context, "x1 vs tsum scint",600,-300,300,pevent.x1,512,0,16000,pevent.fp1_tsum);
+			MyFill(context, "x1 vs anodeBack",600,-300,300,pevent.x1,512,0,4096,pevent.anodeBack);
 		}
 		
 		// build X2 from the delay line times
@@ -193,10 +237,10 @@ namespace EventBuilder {
 			pevent.x2_sum = pevent.fp2_tsum; // testing JCE 2025
 
 
-			MyFill("x2",1200,-600,600,pevent.x2);
+			MyFill(context, "x2",1200,-600,600,pevent.x2);
 			//MyFill("x2_tsum",512,0,16000,pevent.x2_sum);
-			MyFill("x2 vs tsum scint",600,-300,300,pevent.x2,512,0,16000,pevent.fp2_tsum);
-			MyFill("x2 vs anodeBack",600,-300,300,pevent.x2,512,0,4096,pevent.anodeBack);
+			MyFill(context, "x2 vs tsum scint",600,-300,300,pevent.x2,512,0,16000,pevent.fp2_tsum);
+			MyFill(context, "x2 vs anodeBack",600,-300,300,pevent.x2,512,0,4096,pevent.anodeBack);
 		}
 
 
@@ -216,145 +260,61 @@ namespace EventBuilder {
 				pevent.sabreWedgeTime[j] = event.sabreArray[j].wedges[0].Time;
 			}
 			/*Aaaand passes on all of the rest. 4/24/20 GWM*/
-			pevent.sabreArray[j] = event.sabreArray[j];
+			AssignHits(pevent.sabreArray[j].rings, event.sabreArray[j].rings);
+			AssignHits(pevent.sabreArray[j].wedges, event.sabreArray[j].wedges);
 		}
 
 
-		/*
-		
-			//here we place the CATRiNA detector analysis into the event structure
-
-		for(int j=0; j<7; j++) {
-           
-            if(!event.catrinaArray[j].cebr.empty())
-            {
-                // for(unsigned int l=0; l<=event.cebraArray[j].cebr.size(); l++){
-                //    if(j==0){
-                //         MyFill("CebraE0",4096,0,4096,event.cebraArray[j].cebr[l].Long);}
-                //     else if(j==1){
-                //         MyFill("CebraE1",4096,0,4096,event.cebraArray[j].cebr[l].Long);}    
-                //     else if(j==2){
-                //         MyFill("CebraE2",4096,0,4096,event.cebraArray[j].cebr[l].Long);}
-                //     else if(j==3){
-                //         MyFill("CebraE3",4096,0,4096,event.cebraArray[j].cebr[l].Long);}
-                //     else if(j==4){
-                //         MyFill("CebraE4",4096,0,4096,event.cebraArray[j].cebr[l].Long);}
-                   
-                //    }
-
-                if(j==0){
-                    pevent.cebraE0 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel0 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime0 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==1){
-                    pevent.cebraE1 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel1 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime1 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==2){
-                    pevent.cebraE2 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel2 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime2 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==3){
-                    pevent.cebraE3 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel3 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime3 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==4){
-                    pevent.cebraE4 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel4 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime4 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==5){
-                    pevent.cebraE5 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel5 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime5 = event.cebraArray[j].cebr[0].Time;
-                }
-
-                else if(j==6){
-                    pevent.cebraE6 = pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-                    pevent.cebraChannel6 = event.cebraArray[j].cebr[0].Ch;
-                    pevent.cebraTime6 = event.cebraArray[j].cebr[0].Time;
-                }
-     
-            pevent.cebraE[j] = event.cebraArray[j].cebr[0].Long;
-            pevent.cebraChannel[j] = event.cebraArray[j].cebr[0].Ch;
-            pevent.cebraTime[j] = event.cebraArray[j].cebr[0].Time;
-
-            j=j++;
-     
-    //   MyFill("CeBrAE vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);
-    //   if(j==0){
-    //         MyFill("CeBrA.E.0 vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);}
-    //         else if(j==1){
-    //         MyFill("CeBrA.E.1 vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);}
-    //         else if(j==2){
-    //         MyFill("CeBrA.E.2 vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);}
-    //         else if(j==3){
-    //         MyFill("CeBrA.E.3 vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);}
-    //         else if(j==4){
-    //         MyFill("CeBrA.E.4 vs CeBrA_channel",4096,0,4096,pevent.cebraE[j],200,0,200,pevent.cebraChannel[j]);}
-    }
-
-    // if(pevent.cebraE[0]!=-1 && pevent.cebraE[1]!=-1){
-    //         MyFill("cebraE0_vs_cebraE1_noCuts",4096,0,4096,pevent.cebraE[0],4096,0,4096,pevent.cebraE[1]);
-    //         MyFill("cebraTime0-cebraTime1_noCuts",3000,-1500,1500,pevent.cebraTime[0]-pevent.cebraTime[1]);
-    //         }
-    // if(pevent.cebraE[0]!=-1 && pevent.cebraE[2]!=-1){
-    //         MyFill("cebraE0_vs_cebraE2_noCuts",4096,0,4096,pevent.cebraE[0],4096,0,4096,pevent.cebraE[2]);
-    //         MyFill("cebraTime0-cebraTime2_noCuts",3000,-1500,1500,pevent.cebraTime[0]-pevent.cebraTime[2]);
-    //         }
-    // if(pevent.cebraE[0]!=-1 && pevent.cebraE[3]!=-1){
-    //         MyFill("cebraE0_vs_cebraE3_noCuts",4096,0,4096,pevent.cebraE[0],4096,0,4096,pevent.cebraE[3]);
-    //         MyFill("cebraTime0-cebraTime3_noCuts",3000,-1500,1500,pevent.cebraTime[0]-pevent.cebraTime[3]);
-    //         }
-    // if(pevent.cebraE[0]!=-1 && pevent.cebraE[4]!=-1){
-    //         MyFill("cebraE0_vs_cebraE4_noCuts",4096,0,4096,pevent.cebraE[0],4096,0,4096,pevent.cebraE[4]);
-    //         MyFill("cebraTime0-cebraTime4_noCuts",3000,-1500,1500,pevent.cebraTime[0]-pevent.cebraTime[4]);
-    //         }
-    /*Aaaand passes on all of the rest. 4/24/20 GWM // adjusted Mark
-    pevent.cebraArray[j] = event.cebraArray[j];
-  }
-
-  
-        if(pevent.cebraE[0]!=-1){ 
-            MyFill("CebraE0",4096,0,4096,pevent.cebraE[0]);}
-        if(pevent.cebraE[1]!=-1){ 
-            MyFill("CebraE1",4096,0,4096,pevent.cebraE[1]);}
-        if(pevent.cebraE[2]!=-1){ 
-            MyFill("CebraE2",4096,0,4096,pevent.cebraE[2]);}
-        if(pevent.cebraE[3]!=-1){ 
-            MyFill("CebraE3",4096,0,4096,pevent.cebraE[3]);}
-        if(pevent.cebraE[4]!=-1){ 
-            MyFill("CebraE4",4096,0,4096,pevent.cebraE[4]);}
-        if(pevent.cebraE[5]!=-1){ 
-            MyFill("CebraE5",4096,0,4096,pevent.cebraE[5]);}
-        if(pevent.cebraE[6]!=-1){ 
-            MyFill("CebraE6",4096,0,4096,pevent.cebraE[6]);}
-
-
+		/*CATRiNA data: first hit of each detector into the event, then PSD over every hit*/
+		context.psd.Clear();
+		context.psd.SetNeutronThreshold(m_psdThreshold);
+		std::size_t firstHit[s_nCatrina];
+		for(int j=0; j<s_nCatrina; j++)
+		{
+			const auto& hits = event.catrinaArray[j].catr;
+			firstHit[j] = context.psd.GetNumberOfHits();
+			if(hits.empty())
+				continue;
+
+			pevent.*s_catrinaEScalars[j] = pevent.catrinaE[j] = hits[0].Long;
+			pevent.*s_catrinaChannelScalars[j] = pevent.catrinaChannel[j] = hits[0].Ch;
+			pevent.*s_catrinaTimeScalars[j] = pevent.catrinaTime[j] = hits[0].Time;
+			pevent.catrinaShort[j] = hits[0].Short;
+			AssignHits(pevent.catrinaArray[j].catr, hits);
+			for(auto& hit : hits)
+				context.psd.AddHit(j, hit);
+		}
+		context.psd.Process();
 
-		
-		
-	*/
+		//PSD and tail/total histograms are filled in the same pass over the hits
+		for(std::size_t i=0; i<context.psd.GetNumberOfHits(); i++)
+		{
+			int j = context.psd.GetDetector(i);
+			if(i == firstHit[j])
+			{
+				pevent.catrinaPSD[j] = context.psd.GetTailTotal(i);
+				pevent.catrinaParticle[j] = context.psd.GetParticle(i);
+			}
+			MyFill(context, s_catrinaPSDNames[j],512,0,4096,context.psd.GetLong(i),500,0,1,context.psd.GetTailTotal(i));
+			MyFill(context, s_catrinaTailTotalNames[j],500,0,1,context.psd.GetTailTotal(i));
+			MyFill(context, "catrina PSD",512,0,4096,context.psd.GetLong(i),500,0,1,context.psd.GetTailTotal(i));
+			MyFill(context, "catrina tail/total",500,0,1,context.psd.GetTailTotal(i));
+			if(context.psd.GetParticle(i) == 1.0)
+				MyFill(context, "catrina neutron E",4096,0,4096,context.psd.GetLong(i));
+			else if(context.psd.GetParticle(i) == 0.0)
+				MyFill(context, "catrina gamma E",4096,0,4096,context.psd.GetLong(i));
+		}
 
 	
 		/*Make some histograms and xavg*/
-		MyFill("anodeBack vs scintLeft",512,0,4096,pevent.scintLeft,512,0,4096,pevent.anodeBack);
+		MyFill(context, "anodeBack vs scintLeft",512,0,4096,pevent.scintLeft,512,0,4096,pevent.anodeBack);
 
 
 		if(pevent.x1 != -1e6 && pevent.x2 != -1e6) 
 		{
 			// calculate xavg
 			pevent.xavg = pevent.x1*w1 + pevent.x2*w2;
-			MyFill("xavg",1200,-400,400,pevent.xavg);
+			MyFill(context, "xavg",1200,-400,400,pevent.xavg);
 
 			if((pevent.x2 - pevent.x1) > 0) 
 				pevent.theta = std::atan((pevent.x2 - pevent.x1)/36.0);
@@ -362,8 +322,8 @@ namespace EventBuilder {
 				pevent.theta = TMath::Pi() + std::atan((pevent.x2 - pevent.x1)/36.0);
 			else 
 				pevent.theta = TMath::Pi()/2.0;
-			MyFill("xavg vs theta",600,-300,300,pevent.xavg,314,0,3.14,pevent.theta);
-			MyFill("x1 vs x2",600,-300,300,pevent.x1,600,-300,300,pevent.x2);
+			MyFill(context, "xavg vs theta",600,-300,300,pevent.xavg,314,0,3.14,pevent.theta);
+			MyFill(context, "x1 vs x2",600,-300,300,pevent.x1,600,-300,300,pevent.x2);
 
 		}
 
@@ -377,7 +337,7 @@ namespace EventBuilder {
 			pevent.x1FL = pevent.fp1FL_tdiff_anodeFront*1.0/2.10; //position from time, based on delayFL and anodeFront
 			pevent.x1FL_sum = pevent.fp1_tsum_FL; // testing JCE 2025
 			
-			MyFill("x1_FL",1200,-150,700,pevent.x1FL);
+			MyFill(context, "x1_FL",1200,-150,700,pevent.x1FL);
 			//MyFill("x1_FL_tsum",512,0,16000,pevent.x1FL_sum);
 			//MyFill("x1_FL vs tsum",600,-300,300,pevent.x1FL,512,0,16000,pevent.fp1_tsum_FL);
 			// MyFill("x1_FL vs anodeFront",600,-300,300,pevent.x1FL,512,0,4096,pevent.anodeFront);
@@ -394,7 +354,7 @@ namespace EventBuilder {
 			pevent.fp1_tsum_FR = (event.focalPlane.delayFR[0].Time + pevent.anodeFrontTime) - (2*event.focalPlane.scintL[0].Time);
 			pevent.x1FR_sum = pevent.fp1_tsum_FR; // testing JCE 2025
 
-			MyFill("x1_FR",1200,-100,600,pevent.x1FR);
+			MyFill(context, "x1_FR",1200,-100,600,pevent.x1FR);
 			//MyFill("x1_FR_tsum",512,0,16000,pevent.x1FR_sum);
 			//MyFill("x1_FR vs tsum",600,-300,300,pevent.x1FR,512,0,16000,pevent.fp1_tsum_FR);
 			// MyFill("x1_FR vs anodeFront",600,-300,300,pevent.x1FR,512,0,4096,pevent.anodeFront);
@@ -410,7 +370,7 @@ namespace EventBuilder {
 			pevent.fp1_tsumA = (pevent.fp1FL_tdiff_anodeFront + pevent.fp1FR_tdiff_anodeFront);
 			pevent.x1_sumA = pevent.fp1_tsumA; // testing JCE 2025
 
-			MyFill("x1 vs tsum anode",600,-300,300,pevent.x1,1200,0,2000,pevent.fp1_tsumA);
+			MyFill(context, "x1 vs tsum anode",600,-300,300,pevent.x1,1200,0,2000,pevent.fp1_tsumA);
 		}
 
 
@@ -424,7 +384,7 @@ namespace EventBuilder {
 			pevent.x2BL_sum = pevent.fp2_tsum_BL; // testing JCE 2025
 
 
-			MyFill("x2_BL",1200,-300,800,pevent.x2BL);
+			MyFill(context, "x2_BL",1200,-300,800,pevent.x2BL);
 			//MyFill("x2_BL_tsum",512,0,16000,pevent.x2BL_sum);
 			//MyFill("x2_BL vs tsum",600,-300,300,pevent.x2BL,512,0,16000,pevent.fp2_tsum_BL);
 			// MyFill("x2_BL vs anodeFront",600,-300,300,pevent.x2BL,512,0,4096,pevent.anodeFront);
@@ -443,7 +403,7 @@ namespace EventBuilder {
 			pevent.x2BR_sum = pevent.fp2_tsum_BR; // testing JCE 2025
 
 
-			MyFill("x2_BR",1200,-300,800,pevent.x2BR);
+			MyFill(context, "x2_BR",1200,-300,800,pevent.x2BR);
 			//MyFill("x2_BR_tsum",512,0,16000,pevent.x2BR_sum);
 			//MyFill("x2_BR vs tsum",600,-300,300,pevent.x2BR,512,0,16000,pevent.fp2_tsum_BR);
 			//MyFill("x2_BR vs anodeFront",600,-300,300,pevent.x2BR,512,0,4096,pevent.anodeFront);
@@ -458,7 +418,7 @@ namespace EventBuilder {
 			pevent.fp2_tsumB = (pevent.fp2BL_tdiff_anodeBack + pevent.fp2BR_tdiff_anodeBack);
 			pevent.x2_sumB = pevent.fp2_tsumB; // testing JCE 2025
 						
-			MyFill("x2 vs tsum anode",600,-300,300,pevent.x2,500,950,1450,pevent.fp2_tsumB);
+			MyFill(context, "x2 vs tsum anode",600,-300,300,pevent.x2,500,950,1450,pevent.fp2_tsumB);
 		}
 
 //#############################################################################################################
@@ -472,7 +432,7 @@ namespace EventBuilder {
 			pevent.fp1FL_tdiff_tilde = (pevent.fp1FL_tdiff_anodeFront - 1200/2.0);
 			pevent.x1tilde_FL = pevent.fp1FL_tdiff_tilde*1.0/2.10; //position from time, based on delayFL and anodeFront
 						
-			MyFill("x1_tilde_FL",1200,-500,500,pevent.x1tilde_FL);
+			MyFill(context, "x1_tilde_FL",1200,-500,500,pevent.x1tilde_FL);
 		}
 
 		// build X1 with only half the delay line time (right side)
@@ -481,7 +441,7 @@ namespace EventBuilder {
 			pevent.fp1FR_tdiff_tilde = (1200/2.0 - pevent.fp1FR_tdiff_anodeFront);
 			pevent.x1tilde_FR = pevent.fp1FR_tdiff_tilde*1.0/2.10; //position from time, based on delayFR and anodeFront
 						
-			MyFill("x1_tilde_FR",1200,-300,500,pevent.x1tilde_FR);
+			MyFill(context, "x1_tilde_FR",1200,-300,500,pevent.x1tilde_FR);
 		}
 		
 		// build X2 with only half the delay line time (left side)
@@ -490,7 +450,7 @@ namespace EventBuilder {
 			pevent.fp2BL_tdiff_tilde = (pevent.fp2BL_tdiff_anodeBack - 1154/2.0);
 			pevent.x2tilde_BL = pevent.fp2BL_tdiff_tilde*1.0/1.98; //position from time, based on delayBL and anodeBack
 						
-			MyFill("x2_tilde_BL",1200,-400,400,pevent.x2tilde_BL);
+			MyFill(context, "x2_tilde_BL",1200,-400,400,pevent.x2tilde_BL);
 		}
 
 		// build X2 with only half the delay line time (right side)
@@ -499,7 +459,7 @@ namespace EventBuilder {
 			pevent.fp2BR_tdiff_tilde = (1154/2.0 - pevent.fp2BR_tdiff_anodeBack); 
 			pevent.x2tilde_BR = pevent.fp2BR_tdiff_tilde*1.0/1.98; //position from time, based on delayBR and anodeBack
 						
-			MyFill("x2_tilde_BR",1200,-400,400,pevent.x2tilde_BR);
+			MyFill(context, "x2_tilde_BR",1200,-400,400,pevent.x2tilde_BR);
 		}
 
 //#############################################################################################################
@@ -512,7 +472,7 @@ namespace EventBuilder {
 		{
 			// calculate xavg_tilde
 			pevent.xavg_tildeFRBL = pevent.x1tilde_FR*w1 + pevent.x2tilde_BL*w2; 
-			MyFill("xavg_tilde_FRBL",1200,-400,400,pevent.xavg_tildeFRBL);
+			MyFill(context, "xavg_tilde_FRBL",1200,-400,400,pevent.xavg_tildeFRBL);
 		}
 
 		// make a new Xavg with the ~x1_FL and ~x2_BR
@@ -520,7 +480,7 @@ namespace EventBuilder {
 		{
 			// calculate xavg_tilde
 			pevent.xavg_tildeFLBR = pevent.x1tilde_FL*w1 + pevent.x2tilde_BR*w2;
-			MyFill("xavg_tilde_FLBR",1200,-400,400,pevent.xavg_tildeFLBR);
+			MyFill(context, "xavg_tilde_FLBR",1200,-400,400,pevent.xavg_tildeFLBR);
 		}
 
 		// make a new Xavg with the ~x1_FL and ~x2_BL
@@ -528,7 +488,7 @@ namespace EventBuilder {
 		{
 			// calculate xavg_tilde
 			pevent.xavg_tildeFLBL = pevent.x1tilde_FL*w1 + pevent.x2tilde_BL*w2;
-			MyFill("xavg_tilde_FLBL",1200,-400,400,pevent.xavg_tildeFLBL);
+			MyFill(context, "xavg_tilde_FLBL",1200,-400,400,pevent.xavg_tildeFLBL);
 		}
 
 		// make a new Xavg with the ~x1_FR and ~x2_BR
@@ -536,7 +496,7 @@ namespace EventBuilder {
 		{
 			// calculate xavg_tilde
 			pevent.xavg_tildeFRBR = pevent.x1tilde_FR*w1 + pevent.x2tilde_BR*w2;
-			MyFill("xavg_tilde_FRBR",1200,-400,400,pevent.xavg_tildeFRBR);
+			MyFill(context, "xavg_tilde_FRBR",1200,-400,400,pevent.xavg_tildeFRBR);
 		}
 
 //#############################################################################################################
@@ -564,9 +524,20 @@ namespace EventBuilder {
 
 	}
 	
+	template void SFPAnalyzer::Analyze<CoincEvent>(const CoincEvent&, ProcessedEvent&, AnalysisContext&) const;
+	template void SFPAnalyzer::Analyze<HitEvent>(const HitEvent&, ProcessedEvent&, AnalysisContext&) const;
+	
 	ProcessedEvent SFPAnalyzer::GetProcessedEvent(CoincEvent& event)
 	{
-		AnalyzeEvent(event);
+		ProcessedEvent pevent;
+		Analyze(event, pevent, m_context);
+		return pevent;
+	}
+
+	ProcessedEvent SFPAnalyzer::GetProcessedEvent(const HitEvent& event)
+	{
+		ProcessedEvent pevent;
+		Analyze(event, pevent, m_context);
 		return pevent;
 	}
 
@@ -11,10 +11,30 @@
 #define SFPANALYZER_H
 
 #include "DataStructs.h"
+#include "HitEvent.h"
 #include "FP_kinematics.h"
+#include "PulseShape.h"
 
 namespace EventBuilder {
 
+	/*
+		Everything an analysis writes besides its ProcessedEvent: the histogram table and the PSD scratch arrays.
+		Analyze() is const on the analyzer, so one analyzer can serve many threads as long as each has its own
+		context. Worker contexts are detached; their histograms belong to no ROOT directory (and so to no other
+		thread) and are deleted with the context, after being merged into the analyzer's own table.
+	*/
+	struct AnalysisContext
+	{
+		AnalysisContext(bool detach = false);
+		~AnalysisContext();
+		AnalysisContext(const AnalysisContext&) = delete;
+		AnalysisContext& operator=(const AnalysisContext&) = delete;
+
+		THashTable* histograms;
+		PulseShapeStage psd;
+		bool detachHistograms;
+	};
+
 	class SFPAnalyzer
 	{
 	public:
@@ -22,25 +42,30 @@ namespace EventBuilder {
 		            double b, double nudge, double Q);
 		~SFPAnalyzer();
 		ProcessedEvent GetProcessedEvent(CoincEvent& event);
-		inline void ClearHashTable() { rootObj->Clear(); }
-		inline THashTable* GetHashTable() { return rootObj; }
+		ProcessedEvent GetProcessedEvent(const HitEvent& event);
+		inline void ClearHashTable() { m_context.histograms->Clear(); }
+		inline THashTable* GetHashTable() { return m_context.histograms; }
+		inline void SetPSDThreshold(double threshold) { m_psdThreshold = threshold; } //CATRiNA neutron/gamma split in tail/total
+
+		//Per-event kernel; reads only the kinematic setup, so it is safe to call concurrently with separate contexts
+		template<typename Event>
+		void Analyze(const Event& event, ProcessedEvent& pevent, AnalysisContext& context) const;
+		void MergeHistograms(const AnalysisContext& context); //sum a worker's histograms into this analyzer's table
 	
 	private:
-		void Reset(); //Sets ouput structure back to "zero"
 		void GetWeights(); //weights for xavg
-		void AnalyzeEvent(CoincEvent& event);
 	
 		/*Fill wrappers for use with THashTable*/
-		void MyFill(const std::string& name, int binsx, double minx, double maxx, double valuex,
-					int binsy, double miny, double maxy, double valuey);
-		void MyFill(const std::string& name, int binsx, double minx, double maxx, double valuex);
-	
-		CoincEvent *event_address; //Input branch address
-		ProcessedEvent pevent, blank; //output branch and reset
+		static void MyFill(AnalysisContext& context, const std::string& name, int binsx, double minx, double maxx, double valuex,
+						   int binsy, double miny, double maxy, double valuey);
+		static void MyFill(AnalysisContext& context, const std::string& name, int binsx, double minx, double maxx, double valuex);
 	
 		double w1, w2, zfp; //weights and focal plane shift
+		double m_psdThreshold;
 	
-		THashTable *rootObj; //root storage
+		AnalysisContext m_context; //used by GetProcessedEvent
+
+		static constexpr int s_nCatrina = sizeof(CoincEvent::catrinaArray)/sizeof(CoincEvent::catrinaArray[0]);
 	};
 
 }
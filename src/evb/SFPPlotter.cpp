@@ -7,15 +7,19 @@
  */
 
 #include "SFPPlotter.h"
+#include "ColumnarCache.h"
 #include <TSystem.h>
 #include <filesystem>
+#include <algorithm>
+#include <memory>
 #include <fstream>
+#include <unordered_set>
 
 namespace EventBuilder {
 
 	/*Generates storage and initializes pointers*/
 	SFPPlotter::SFPPlotter() :
-		event_address(new ProcessedEvent()), m_progressFraction(0.1)
+		event_address(new ProcessedEvent()), m_outfile(nullptr), m_table(nullptr), m_progressFraction(0.1)
 	{
 	}
 	
@@ -34,6 +38,7 @@ namespace EventBuilder {
 		else
 		{
 			TH2F *h = new TH2F(name.c_str(), name.c_str(), binsx, minx, maxx, binsy, miny, maxy);
+			h->SetDirectory(m_outfile); //gDirectory may be a converter's output file when filled from a chained operation
 			h->Fill(valuex, valuey);
 			table->Add(h);
 		}
@@ -48,6 +53,7 @@ namespace EventBuilder {
 		else 
 		{
 			TH1F *h = new TH1F(name.c_str(), name.c_str(), binsx, minx, maxx);
+			h->SetDirectory(m_outfile);
 			h->Fill(valuex);
 			table->Add(h);
 		}
@@ -452,35 +458,213 @@ namespace EventBuilder {
 		}
 	}
 	
-	/*Runs a list of files given from a RunCollector class*/
-	void SFPPlotter::Run(const std::vector<std::string>& files, const std::string& output)
+	/*
+		Incremental interface: Begin opens the outputs, Fill takes one analyzed event, End writes the histograms.
+		Run uses it to plot analyzed files; the fused analyze+plot modes call it directly with events fresh from
+		SFPAnalyzer, so no analyzed tree has to be written or read back.
+	*/
+	bool SFPPlotter::Begin(const std::string& output)
 	{
-		
-		std::ofstream csv_file1("X1_events.csv");
-		csv_file1 << "x1,x2,delayFL,delayFR,delayBL,delayBR,anodeF,anodeB,scintL,scintR\n";  // header row
+		m_csvUncut.open("X1_events.csv");
+		m_csvUncut << "x1,x2,delayFL,delayFR,delayBL,delayBR,anodeF,anodeB,scintL,scintR\n";  // header row
 
-		std::ofstream csv_file2("X1_events_cut.csv");
-		csv_file2 << "x1,x2,delayFL,delayFR,delayBL,delayBR,anodeF,anodeB,scintL,scintR\n";  // header row
+		m_csvCut.open("X1_events_cut.csv");
+		m_csvCut << "x1,x2,delayFL,delayFR,delayBL,delayBR,anodeF,anodeB,scintL,scintR\n";  // header row
+
+		m_outfile = TFile::Open(output.c_str(), "RECREATE");
+		if(m_outfile == nullptr || !m_outfile->IsOpen())
+		{
+			EVB_ERROR("Unable to open histogram file {0} at SFPPlotter::Begin()!", output);
+			m_csvUncut.close();
+			m_csvCut.close();
+			return false;
+		}
 
-		
-		TFile *outfile = TFile::Open(output.c_str(), "RECREATE");
-		TChain* chain = new TChain("SPSTree");
-		for(unsigned int i=0; i<files.size(); i++)
-			chain->Add(files[i].c_str()); 
-		chain->SetBranchAddress("event", &event_address);
-		
 		// reset the loss counters
 		lossinX1_uncut = 0;
 		lossinX1_cut = 0;
-		std::string run_NO = std::filesystem::path(output).stem().string();
 
-		THashTable* table = new THashTable();
-	
-		long blentries = chain->GetEntries();
+		m_table = new THashTable();
+		return true;
+	}
+
+	void SFPPlotter::Fill(const ProcessedEvent& event)
+	{
+		MakeUncutHistograms(event, m_table, &m_csvUncut);
+		if(cutter.IsValid()) MakeCutHistograms(event, m_table, &m_csvCut);
+	}
+
+	void SFPPlotter::End()
+	{
+		if(m_outfile == nullptr)
+			return;
+
+		m_outfile->cd();
+		m_table->Write();
+		if(cutter.IsValid()) 
+		{
+			auto clist = cutter.GetCuts();
+			for(unsigned int i=0; i<clist.size(); i++) 
+			  clist[i]->Write();
+		}
+		delete m_table;
+		m_table = nullptr;
+		m_outfile->Close();
+		delete m_outfile;
+		m_outfile = nullptr;
+		m_csvUncut.close();
+		m_csvCut.close();
+
+		//EVB_INFO("# of events with x1 only ungated: {}, and gated: {}.", lossinX1_uncut, lossinX1_cut);
+	}
+
+	/*
+		ProcessedEvent members read by the histogram fill functions plus whatever the cuts reference. Only these
+		are read from disk (branches in the TChain, columns in a columnar cache), so keep this in sync with
+		MakeUncutHistograms/MakeCutHistograms.
+	*/
+	std::vector<std::string> SFPPlotter::GetRequiredBranches()
+	{
+		std::vector<std::string> names = {
+			"x1", "x2", "xavg", "theta", "x1tilde_FL", "x1tilde_FR", "x2tilde_BL", "x2tilde_BR",
+			"fp1_tsumA", "fp2_tsumB", "scintLeft", "scintLeftTime", "scintRightTime",
+			"anodeFront", "anodeFrontTime", "anodeBack", "anodeBackTime", "cathode",
+			"delayFrontLeftE", "delayFrontRightE", "delayBackLeftE", "delayBackRightE",
+			"delayFrontLeftTime", "delayFrontRightTime", "delayBackLeftTime", "delayBackRightTime",
+			"delayFrontMaxTime", "delayBackMaxTime",
+			"sabreRingE", "sabreRingTime", "sabreRingChannel", "sabreWedgeE", "sabreWedgeTime", "sabreWedgeChannel"
+		};
+
+		if(cutter.IsValid())
+		{
+			for(auto& var : cutter.GetRequiredVariables())
+			{
+				if(std::find(names.begin(), names.end(), var) == names.end())
+					names.push_back(var);
+			}
+		}
+		return names;
+	}
+
+	std::vector<std::string> SFPPlotter::GetRequiredFields()
+	{
+		std::vector<std::string> names = GetRequiredBranches();
+
+		//Expand array members (sabreRingE -> sabreRingE[0], ...)
+		std::vector<std::string> fields;
+		for(auto& field : GetProcessedEventFields())
+		{
+			std::string base = field.name.substr(0, field.name.find('['));
+			if(std::find(names.begin(), names.end(), base) != names.end())
+				fields.push_back(field.name);
+		}
+		return fields;
+	}
+
+	//Every (sub-)branch name, with array dimensions removed as SetBranchStatus() does when matching
+	static void CollectBranchNames(TObjArray* branches, std::unordered_set<std::string>& names)
+	{
+		if(branches == nullptr)
+			return;
+		for(int i=0; i<branches->GetEntries(); i++)
+		{
+			TBranch* branch = (TBranch*) branches->At(i);
+			std::string name = branch->GetName();
+			names.insert(name.substr(0, name.find('[')));
+			CollectBranchNames(branch->GetListOfBranches(), names);
+		}
+	}
+
+	/*
+		The event branch is fully split, so each member is its own sub-branch. Turn everything off and re-enable
+		only the members we use; in particular the sabreArray/catrinaArray hit vectors are never read. Enabling
+		a sub-branch re-enables its parent. The active branches are prefetched through a TTreeCache.
+
+		Every name is checked against the tree first. If any is missing (a stale name here, or a file written by
+		an older ProcessedEvent), all branches are left on instead: slower, but the histograms are still right.
+	*/
+	void SFPPlotter::ActivateBranches(TChain* chain)
+	{
+		std::vector<std::string> branches = GetRequiredBranches();
+		chain->SetCacheSize(s_readCacheSize);
+
+		std::unordered_set<std::string> available;
+		if(chain->LoadTree(0) >= 0)
+			CollectBranchNames(chain->GetListOfBranches(), available);
+
+		std::string missing;
+		for(auto& name : branches)
+		{
+			if(available.count(name) != 0)
+				continue;
+			if(!FindProcessedEventField(name) && !FindProcessedEventField(name + "[0]"))
+				EVB_WARN("Branch {0} requested at SFPPlotter::ActivateBranches() is not a ProcessedEvent member.", name);
+			missing += missing.empty() ? name : ", " + name;
+		}
+		if(!missing.empty())
+		{
+			EVB_WARN("SPSTree has no branch for {0} at SFPPlotter::ActivateBranches(); reading all branches instead, which is slower.", missing);
+			chain->AddBranchToCache("*", true);
+			return;
+		}
+
+		chain->SetBranchStatus("*", false);
+		for(auto& name : branches)
+		{
+			chain->SetBranchStatus(name.c_str(), true);
+			chain->AddBranchToCache(name.c_str(), true);
+		}
+		chain->StopCacheLearningPhase();
+	}
+
+	/*
+		Plots a list of analyzed files, reading each from its columnar cache when one is valid. Files are processed
+		in the order given; consecutive files without a cache are read through one TChain.
+	*/
+	void SFPPlotter::Run(const std::vector<std::string>& files, const std::string& output)
+	{
+		if(!Begin(output))
+			return;
+
+		//Each source is either one cached file or a chain of consecutive uncached files
+		struct Source
+		{
+			std::unique_ptr<ColumnarCacheReader> cache;
+			std::unique_ptr<TChain> chain;
+		};
+		std::vector<std::string> requiredFields = GetRequiredFields();
+		std::vector<Source> sources;
+		for(unsigned int i=0; i<files.size(); i++)
+		{
+			if(ColumnarCacheReader::HasValidCache(files[i]))
+			{
+				auto cache = std::make_unique<ColumnarCacheReader>();
+				if(cache->Open(ColumnarCacheReader::GetCacheDirectory(files[i])) && cache->ActivateColumns(requiredFields))
+				{
+					sources.push_back({std::move(cache), nullptr});
+					continue;
+				}
+			}
+			if(sources.empty() || sources.back().chain == nullptr)
+				sources.push_back({nullptr, std::make_unique<TChain>("SPSTree")});
+			sources.back().chain->Add(files[i].c_str());
+		}
+
+		long blentries = 0;
+		for(auto& source : sources)
+		{
+			if(source.cache)
+				blentries += source.cache->GetEntries();
+			else
+			{
+				source.chain->SetBranchAddress("event", &event_address);
+				ActivateBranches(source.chain.get());
+				blentries += source.chain->GetEntries();
+			}
+		}
 		long count=0, flush_val=blentries*m_progressFraction, flush_count=0;
 	
-	
-		for(long i=0; i<chain->GetEntries(); i++) 
+		auto updateProgress = [&]()
 		{
 			count++;
 			if(count == flush_val)
@@ -489,26 +673,35 @@ namespace EventBuilder {
 				count=0;
 				m_progressCallback(flush_count*flush_val, blentries);
 			}
-			chain->GetEntry(i);
-			MakeUncutHistograms(*event_address, table, &csv_file1);
-			if(cutter.IsValid()) MakeCutHistograms(*event_address, table, &csv_file2);
-		}
-		outfile->cd();
-		table->Write();
-		if(cutter.IsValid()) 
+		};
+	
+		for(auto& source : sources)
 		{
-			auto clist = cutter.GetCuts();
-			for(unsigned int i=0; i<clist.size(); i++) 
-			  clist[i]->Write();
+			if(source.cache)
+			{
+				uint64_t nentries = source.cache->GetEntries();
+				for(uint64_t i=0; i<nentries; i++)
+				{
+					updateProgress();
+					source.cache->GetEntry(i, *event_address);
+					Fill(*event_address);
+				}
+				source.cache->Close();
+			}
+			else
+			{
+				long nchain = source.chain->GetEntries();
+				for(long i=0; i<nchain; i++) 
+				{
+					updateProgress();
+					source.chain->GetEntry(i);
+					Fill(*event_address);
+				}
+				source.chain.reset(); //release its files before moving on
+			}
 		}
-		delete table;
-		outfile->Close();
-		delete outfile;
-		csv_file1.close();
-		csv_file2.close();
 
-		//EVB_INFO("# of events in {} with x1 only ungated: {}, and gated: {}.", run_NO, lossinX1_uncut, lossinX1_cut);
-		
+		End();
 	}
 
 }
@@ -24,11 +24,17 @@ namespace EventBuilder {
 		~SFPPlotter();
 		inline void ApplyCutlist(const std::string& listname) { cutter.SetCuts(listname); }
 		void Run(const std::vector<std::string>& files, const std::string& output);
+		bool Begin(const std::string& output);
+		void Fill(const ProcessedEvent& event);
+		void End();
 		inline void SetProgressCallbackFunc(const ProgressCallbackFunc& function) { m_progressCallback = function; }
 		inline void SetProgressFraction(double frac) { m_progressFraction = frac; }
 	
 	private:
 		void Chain(const std::vector<std::string>& files); //Form TChain
+		std::vector<std::string> GetRequiredBranches(); //ProcessedEvent members used by the fill functions and cuts
+		std::vector<std::string> GetRequiredFields(); //same, with arrays expanded to their elements
+		void ActivateBranches(TChain* chain);
 		void MakeUncutHistograms(const ProcessedEvent& ev, THashTable* table, std::ofstream* csv_file = nullptr);
 		void MakeCutHistograms(const ProcessedEvent& ev, THashTable* table, std::ofstream* csv_file = nullptr);
 		//void MakeUncutHistograms(const ProcessedEvent& ev, THashTable* table);
@@ -41,11 +47,15 @@ namespace EventBuilder {
 		void MyFill(THashTable* table, const std::string& name, int binsx, double minx, double maxx, double valuex);
 	
 		ProcessedEvent *event_address;
+		TFile* m_outfile;
+		THashTable* m_table;
+		std::ofstream m_csvUncut, m_csvCut;
 	
 		/*Cuts*/
 		CutHandler cutter;
 		
 		ProgressCallbackFunc m_progressCallback;
+		static constexpr Long64_t s_readCacheSize = 64*1024*1024; //TTreeCache size in bytes
 		double m_progressFraction;
 
 		// looking for losses!
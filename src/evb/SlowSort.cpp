@@ -12,69 +12,93 @@ SlowSort.cpp
  */
 
 #include "SlowSort.h"
+#include <algorithm>
+#include <cctype>
 
 namespace EventBuilder {
 
-	/*Sort the Sabre Data in order of descending energy*/
-	bool SabreSort(const DetectorHit& i, const DetectorHit& j) {
-	  return (i.Long>j.Long);
-	}
-	
-	/*Constructor takes input of coincidence window size, and fills sabre channel map*/
+	/*Constructor takes input of coincidence window size, and fills the detector registry*/
 	SlowSort::SlowSort() :
-		m_coincWindow(-1.0), m_eventFlag(false)
+		m_coincWindow(-1.0), m_hitList(s_defaultHitCapacity), m_overflowCount(0), m_triggerOverflowCount(0), m_outOfOrderCount(0), m_lateDropCount(0), m_lastMultiplicity(0), m_lastEventTime(0.0), m_eventFlag(false), startTime(0.0), previousHitTime(0.0),
+		m_mode(BuildMode::Fixed), m_pendingTriggers(s_defaultHitCapacity), m_preWindow(0.0), m_postWindow(0.0), m_lastHitTime(0.0), m_lastWindowEnd(-1.0), m_flushFlag(false)
 	{
-		event_stats = new TH2F("coinc_event_stats","coinc_events_stats;global channel;number of coincident hits;counts",144,0,144,20,0,20);
+		InitEventStats();
 	}
 	
-	SlowSort::SlowSort(double windowSize, const std::string& mapfile) :
-		m_coincWindow(windowSize), m_eventFlag(false), m_event(), cmap(mapfile)
+	SlowSort::SlowSort(double windowSize, const std::string& mapfile, std::size_t hitCapacity) :
+		m_coincWindow(windowSize), m_hitList(hitCapacity), m_overflowCount(0), m_triggerOverflowCount(0), m_outOfOrderCount(0), m_lateDropCount(0), m_lastMultiplicity(0), m_lastEventTime(0.0), m_eventFlag(false), startTime(0.0), previousHitTime(0.0),
+		m_mode(BuildMode::Fixed), m_pendingTriggers(hitCapacity), m_preWindow(0.0), m_postWindow(0.0), m_lastHitTime(0.0), m_lastWindowEnd(-1.0), m_flushFlag(false),
+		m_registry(mapfile)
 	{
-		event_stats = new TH2F("coinc_event_stats","coinc_events_stats;global channel;number of coincident hits;counts",144,0,144,20,0,20);
-		InitVariableMaps();
+		InitEventStats();
 	}
 	
 	SlowSort::~SlowSort() {}
 	
-	/**EXPERIMENT MODS go here**/
-	void SlowSort::InitVariableMaps() 
+	//One x bin per global channel in the map, with the historical 144 as the minimum
+	void SlowSort::InitEventStats()
 	{
-	
-		/*For SABRE: Each SABRE det has ring&wedge, so add the detID to the
-		  SABRERING/WEDGE attribute to differentiate*/
-		varMap[DetAttribute::SabreRing0] = &m_event.sabreArray[0].rings;
-		varMap[DetAttribute::SabreRing1] = &m_event.sabreArray[1].rings;
-		varMap[DetAttribute::SabreRing2] = &m_event.sabreArray[2].rings;
-		varMap[DetAttribute::SabreRing3] = &m_event.sabreArray[3].rings;
-		varMap[DetAttribute::SabreRing4] = &m_event.sabreArray[4].rings;
-		varMap[DetAttribute::SabreWedge0] = &m_event.sabreArray[0].wedges;
-		varMap[DetAttribute::SabreWedge1] = &m_event.sabreArray[1].wedges;
-		varMap[DetAttribute::SabreWedge2] = &m_event.sabreArray[2].wedges;
-		varMap[DetAttribute::SabreWedge3] = &m_event.sabreArray[3].wedges;
-		varMap[DetAttribute::SabreWedge4] = &m_event.sabreArray[4].wedges;
-	
-		/*For focal plane: Only one focal plane, so each variable is uniquely
-		  identified by its attribute
-		*/
-		varMap[DetAttribute::ScintLeft] = &m_event.focalPlane.scintL;
-		varMap[DetAttribute::ScintRight] = &m_event.focalPlane.scintR;
-		varMap[DetAttribute::Cathode] = &m_event.focalPlane.cathode;
-		varMap[DetAttribute::DelayFR] = &m_event.focalPlane.delayFR;
-		varMap[DetAttribute::DelayFL] = &m_event.focalPlane.delayFL;
-		varMap[DetAttribute::DelayBL] = &m_event.focalPlane.delayBL;
-		varMap[DetAttribute::DelayBR] = &m_event.focalPlane.delayBR;
-		varMap[DetAttribute::AnodeFront] = &m_event.focalPlane.anodeF;
-		varMap[DetAttribute::AnodeBack] = &m_event.focalPlane.anodeB;
-		varMap[DetAttribute::Monitor] = &m_event.focalPlane.monitor;
-	
+		int nChannels = std::max(144, m_registry.GetMaxChannel() + 1);
+		event_stats = new TH2F("coinc_event_stats","coinc_events_stats;global channel;number of coincident hits;counts",nChannels,0,nChannels,20,0,20);
+	}
+
+	bool SlowSort::SetMapFile(const std::string& mapfile)
+	{
+		if(!m_registry.Build(mapfile))
+			return false;
+		int nChannels = m_registry.GetMaxChannel() + 1;
+		if(nChannels > event_stats->GetNbinsX())
+			event_stats->SetBins(nChannels,0,nChannels,20,0,20);
+		return true;
 	}
 	
 	/*Reset output structure to blank*/
 	void SlowSort::Reset() 
 	{
-		m_event = m_blank;
+		ClearHitEvent(m_hitEvent);
 	}
 	
+	/*
+		Switch to triggered building. The trigger is either a focal plane part name from the channel map
+		(e.g. SCINTLEFT), a detector name from the registry (e.g. SABRERING_0, every channel of it triggers),
+		or a global channel number. Returns false (and stays in fixed mode) if no channel in the map matches.
+	*/
+	bool SlowSort::SetTriggerMode(const std::string& trigger, double preWindow, double postWindow)
+	{
+		m_isTrigger.assign(m_registry.GetMaxChannel() + 1, 0);
+
+		int detector = m_registry.FindDetector("FOCALPLANE_" + trigger);
+		if(detector == -1)
+			detector = m_registry.FindDetector(trigger);
+
+		bool found = false;
+		if(detector != -1)
+		{
+			for(int gchan : m_registry.GetChannels(detector))
+			{
+				m_isTrigger[gchan] = 1;
+				found = true;
+			}
+		}
+		else if(!trigger.empty() && std::all_of(trigger.begin(), trigger.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+		{
+			int gchan = std::stoi(trigger);
+			if(m_registry.IsMapped(gchan))
+			{
+				m_isTrigger[gchan] = 1;
+				found = true;
+			}
+		}
+
+		if(!found)
+			return false;
+
+		m_mode = BuildMode::Triggered;
+		m_preWindow = preWindow;
+		m_postWindow = postWindow;
+		return true;
+	}
+
 	bool SlowSort::AddHitToEvent(CompassHit& mhit) 
 	{
 		DPPChannel curHit;
@@ -84,95 +108,215 @@ namespace EventBuilder {
 		curHit.Channel = mhit.channel;
 		curHit.Board = mhit.board;
 		curHit.Flags = mhit.flags;
-	
-		if(m_hitList.empty()) 
+
+		if(m_mode == BuildMode::Fixed)
+			return AddHitFixed(curHit);
+		else
+			return AddHitTriggered(curHit);
+	}
+
+	/*
+		Hits are expected in time order (see HitReorderBuffer). Late hits are still used, since dropping them
+		silently loses data, but are counted so that a missing/undersized reorder horizon is visible.
+	*/
+	void SlowSort::CheckOrder(const DPPChannel& curHit)
+	{
+		if(curHit.Timestamp < previousHitTime)
+			++m_outOfOrderCount;
+		else
+			previousHitTime = curHit.Timestamp;
+	}
+
+	bool SlowSort::AddHitFixed(const DPPChannel& curHit)
+	{
+		CheckOrder(curHit);
+		if(m_hitList.IsEmpty()) 
 		{
 			startTime = curHit.Timestamp;
-			m_hitList.push_back(curHit);
+			m_hitList.PushBack(curHit);
 		} 
-		else if (curHit.Timestamp < previousHitTime)
-			return false;
 		else if ((curHit.Timestamp - startTime) < m_coincWindow)
-			m_hitList.push_back(curHit);
+		{
+			//Window is saturated (beam burst, noisy channel); drop and count rather than grow
+			if(!m_hitList.PushBack(curHit))
+			{
+				++m_overflowCount;
+				return false;
+			}
+		}
 		else 
 		{
-			ProcessEvent();
-			m_hitList.clear();
+			ProcessEvent(0, m_hitList.Size());
+			m_hitList.Clear();
 			startTime = curHit.Timestamp;
-			m_hitList.push_back(curHit);
+			m_hitList.PushBack(curHit);
 			m_eventFlag = true;
 		}
 	
 		return true;
 	}
+
+	/*
+		The look-behind must stay time ordered, since event windows and the horizon are found by scanning it from
+		the front. A late hit is inserted at its place, unless it is already older than anything a pending
+		trigger can reach, in which case it is dropped and counted. That includes a late hit inside the window of an
+		event that was already built, unless a pending trigger's window also covers it. Late trigger hits do not
+		open events.
+	*/
+	bool SlowSort::AddHitTriggered(const DPPChannel& curHit)
+	{
+		CheckOrder(curHit);
+		bool isLate = curHit.Timestamp < m_lastHitTime;
+
+		//Drop look-behind that no pending or future trigger can reach
+		double latest = std::max(m_lastHitTime, curHit.Timestamp);
+		double horizon = (m_pendingTriggers.IsEmpty() ? latest : m_pendingTriggers.Front()) - m_preWindow;
+		while(!m_hitList.IsEmpty() && m_hitList.Front().Timestamp < horizon)
+			m_hitList.PopFront();
+
+		bool isInBuiltWindow = curHit.Timestamp <= m_lastWindowEnd &&
+							   (m_pendingTriggers.IsEmpty() || curHit.Timestamp < m_pendingTriggers.Front() - m_preWindow);
+		if(isLate && (curHit.Timestamp < horizon || isInBuiltWindow))
+		{
+			++m_lateDropCount;
+			return false;
+		}
+
+		if(!m_hitList.PushBack(curHit))
+		{
+			++m_overflowCount;
+			return false;
+		}
+
+		if(isLate)
+		{
+			std::size_t position = m_hitList.Size() - 1;
+			while(position > 0 && m_hitList[position - 1].Timestamp > curHit.Timestamp)
+			{
+				m_hitList[position] = m_hitList[position - 1];
+				--position;
+			}
+			m_hitList[position] = curHit;
+			return true;
+		}
+		m_lastHitTime = curHit.Timestamp;
+
+		std::size_t gchan = curHit.Channel + curHit.Board*16;
+		if(gchan < m_isTrigger.size() && m_isTrigger[gchan] &&
+		   (m_pendingTriggers.IsEmpty() || curHit.Timestamp > m_pendingTriggers.Back() + m_postWindow))
+		{
+			//More open triggers than the buffer holds; the trigger hit is still kept as a plain hit
+			if(!m_pendingTriggers.PushBack(curHit.Timestamp))
+				++m_triggerOverflowCount;
+		}
+
+		return true;
+	}
 	
 	void SlowSort::FlushHitsToEvent()
 	{
-		if(m_hitList.empty())
+		if(m_mode == BuildMode::Triggered)
+		{
+			m_flushFlag = true; //all pending triggers are now complete
+			return;
+		}
+
+		if(m_hitList.IsEmpty())
 		{
 			m_eventFlag = false;
 			return;
 		}
 	
-		ProcessEvent();
-		m_hitList.clear();
+		ProcessEvent(0, m_hitList.Size());
+		m_hitList.Clear();
 		m_eventFlag = true;
 	}
 	
+	//ROOT form of the next event, for writing; in-memory consumers should use GetHitEvent()
 	const CoincEvent& SlowSort::GetEvent()
 	{
-		m_eventFlag = false;
+		ConvertToCoincEvent(GetHitEvent(), m_event);
 		return m_event;
 	}
+
+	const HitEvent& SlowSort::GetHitEvent()
+	{
+		if(m_mode == BuildMode::Triggered)
+			BuildTriggeredEvent();
+		else
+			m_eventFlag = false;
+		return m_hitEvent;
+	}
+
+	/*Build the event for the oldest pending trigger. Only valid when IsEventReady() is true.*/
+	void SlowSort::BuildTriggeredEvent()
+	{
+		double triggerTime = m_pendingTriggers.Front();
+		m_pendingTriggers.PopFront();
+		m_lastWindowEnd = triggerTime + m_postWindow;
+
+		std::size_t begin = 0;
+		std::size_t size = m_hitList.Size();
+		while(begin < size && m_hitList[begin].Timestamp < triggerTime - m_preWindow)
+			++begin;
+		std::size_t end = begin;
+		while(end < size && m_hitList[end].Timestamp <= triggerTime + m_postWindow)
+			++end;
+		ProcessEvent(begin, end);
+
+		if(!m_pendingTriggers.IsEmpty())
+		{
+			double horizon = m_pendingTriggers.Front() - m_preWindow;
+			while(!m_hitList.IsEmpty() && m_hitList.Front().Timestamp < horizon)
+				m_hitList.PopFront();
+		}
+	}
 	
 	/*Function called when an event outside the coincidence window is detected
 	 *Process all of the hits in the list, and write them to the sorted tree
 	 */
-	void SlowSort::ProcessEvent()
+	void SlowSort::ProcessEvent(std::size_t begin, std::size_t end)
 	{
 		Reset();
+		m_builtEvent.Clear();
 		DetectorHit dhit;
 		int gchan;
-		int size = m_hitList.size();
-		for(DPPChannel& curHit: m_hitList)
+		int size = end - begin;
+		m_lastMultiplicity = size;
+		m_lastEventTime = size > 0 ? m_hitList[begin].Timestamp : 0.0;
+		for(std::size_t i=begin; i<end; i++)
 		{
+			const DPPChannel& curHit = m_hitList[i];
 			gchan = curHit.Channel + curHit.Board*16; //global channel
 			event_stats->Fill(gchan, size);
 			dhit.Time = curHit.Timestamp/1.0e3;
 			dhit.Ch = gchan;
 			dhit.Long = curHit.Energy;
 			dhit.Short = curHit.EnergyShort;
-			auto channel_info = cmap.FindChannel(gchan);
+			int detector = m_registry.GetDetectorID(gchan);
 	
-			if(channel_info == cmap.End())
+			if(detector == -1)
 			{
-				EVB_WARN("At SlowSort::ProcessEvent() -- Data Assignment Error! Global channel {0} found but not assigned in ChannelMap! Skipping data.",gchan);
+				if(!m_registry.IsMapped(gchan))
+					EVB_WARN("At SlowSort::ProcessEvent() -- Data Assignment Error! Global channel {0} found but not assigned in ChannelMap! Skipping data.",gchan);
+				else
+					EVB_WARN("At SlowSort::ProcessEvent() -- Data Assignment Error! Channel {0} exists in ChannelMap, but is not assigned to a detector! Skipping data.",gchan);
 				continue;
 			}
-			  
-			if(channel_info->second.type == DetType::FocalPlane)
-			{
-			  auto variable = varMap.find(channel_info->second.attribute);
-			  if(variable !=  varMap.end())
-			    variable->second->push_back(dhit);
-			} 
-			else if(channel_info->second.type == DetType::Sabre)
-			{
-				auto variable = varMap.find(channel_info->second.attribute);
-				if(variable != varMap.end())
-					variable->second->push_back(dhit);
-			}
-			else 
-			{
-				EVB_WARN("At SlowSort::ProcessEvent() -- Data Assignment Error! Channel ({0}, {1}, {2}) exists in ChannelMap, but does not have an assigned variable! Skipping data.",
-						gchan, channel_info->second.type, channel_info->second.attribute);
-			}
+			m_builtEvent.AddHit(detector, dhit);
 		}
-		//Organize the SABRE data in descending energy order
-		for(int s=0; s<5; s++)
+		m_builtEvent.Assemble();
+
+		//Organize the SABRE (or any energy ordered) data in descending energy order, then fill the CoincEvent lists
+		for(std::size_t i=0; i<m_builtEvent.GetNumberOfDetectors(); i++)
 		{
-			sort(m_event.sabreArray[s].rings.begin(), m_event.sabreArray[s].rings.end(), SabreSort);
-			sort(m_event.sabreArray[s].wedges.begin(), m_event.sabreArray[s].wedges.end(), SabreSort);
+			const DetectorInfo& info = m_registry.GetDetector(m_builtEvent.GetDetector(i));
+			if(info.sortByEnergy)
+				m_builtEvent.SortByEnergy(i);
+			if(info.legacyList == -1)
+				continue; //no CoincEvent list; warned about when the registry was built
+			HitRange hits = m_builtEvent.GetHitsAt(i);
+			GetHitList(m_hitEvent, info.legacyList).assign(hits.begin(), hits.end());
 		}
 	}
 
@@ -6,15 +6,29 @@
  * Gordon M. Oct. 2019
  *
  * Refurbished and updated Jan 2020 GWM
+ *
+ * Two build modes are available. Fixed opens a window at the first hit and closes it once a hit
+ * falls outside of it. Triggered builds one event per trigger hit (e.g. SCINTLEFT), taking all hits
+ * within [trigger - pre, trigger + post]; hits are held in a time-ordered look-behind buffer until
+ * no pending trigger can claim them. Triggers inside the post window of a pending trigger do not
+ * open a new event. With a pre window the windows of successive triggers can still overlap; a hit in
+ * the overlap is copied into both events.
+ *
+ * Channels are assigned to detectors by a DetectorRegistry built from the channel map. Each event is
+ * built into a BuiltEvent (hits grouped by detector ID), and detectors that have a CoincEvent list
+ * are then copied into the in-memory HitEvent. GetEvent() converts that to a CoincEvent for writing;
+ * hits of detectors without a CoincEvent list are not written.
  */
 #ifndef SLOW_SORT_H
 #define SLOW_SORT_H
 
 #include "CompassHit.h"
 #include "DataStructs.h"
-#include "ChannelMap.h"
+#include "DetectorRegistry.h"
+#include "BuiltEvent.h"
+#include "HitEvent.h"
+#include "RingBuffer.h"
 #include <TH2.h>
-#include <unordered_map>
 
 namespace EventBuilder {
 
@@ -23,33 +37,77 @@ namespace EventBuilder {
 	
 	public:
 		SlowSort();
-		SlowSort(double windowSize, const std::string& mapfile);
+		enum class BuildMode
+		{
+			Fixed,
+			Triggered
+		};
+
+		SlowSort(double windowSize, const std::string& mapfile, std::size_t hitCapacity = s_defaultHitCapacity);
 		~SlowSort();
+		bool SetTriggerMode(const std::string& trigger, double preWindow, double postWindow);
+		inline BuildMode GetBuildMode() const { return m_mode; }
 		inline void SetWindowSize(double window) { m_coincWindow = window; }
-		inline bool SetMapFile(const std::string& mapfile) { return cmap.FillMap(mapfile); }
+		bool SetMapFile(const std::string& mapfile);
 		bool AddHitToEvent(CompassHit& mhit);
 		const CoincEvent& GetEvent();
+		const HitEvent& GetHitEvent(); //same as GetEvent() without the conversion to CoincEvent
+		inline const BuiltEvent& GetBuiltEvent() const { return m_builtEvent; } //the event last returned by GetEvent()
+		inline const DetectorRegistry& GetRegistry() const { return m_registry; }
 		inline TH2F* GetEventStats() { return event_stats; }
 		void FlushHitsToEvent(); //For use with *last* hit list
-		inline bool IsEventReady() { return m_eventFlag; }
+		inline bool IsEventReady()
+		{
+			if(m_mode == BuildMode::Fixed)
+				return m_eventFlag;
+			return !m_pendingTriggers.IsEmpty() && (m_flushFlag || m_lastHitTime > m_pendingTriggers.Front() + m_postWindow);
+		}
+		inline uint64_t GetOverflowCount() const { return m_overflowCount; } //hits dropped because the hit buffer was full
+		inline std::size_t GetHitCapacity() const { return m_hitList.Capacity(); }
+		inline uint64_t GetTriggerOverflowCount() const { return m_triggerOverflowCount; } //triggers dropped because the pending trigger buffer was full
+		inline uint64_t GetOutOfOrderCount() const { return m_outOfOrderCount; } //hits earlier than their predecessor
+		inline uint64_t GetLateDropCount() const { return m_lateDropCount; } //triggered mode: late hits no pending trigger could claim
+		inline int GetLastEventMultiplicity() const { return m_lastMultiplicity; }
+		inline double GetLastEventTime() const { return m_lastEventTime; } //ps, time of the first hit in the last built event
+
+		static constexpr std::size_t s_defaultHitCapacity = 8192;
 	
 	private:
-		void InitVariableMaps();
+		void InitEventStats();
 		void Reset();
-		void ProcessEvent();
+		void ProcessEvent(std::size_t begin, std::size_t end);
+		void CheckOrder(const DPPChannel& curHit);
+		bool AddHitFixed(const DPPChannel& curHit);
+		bool AddHitTriggered(const DPPChannel& curHit);
+		void BuildTriggeredEvent();
 	
 		double m_coincWindow;
-		std::vector<DPPChannel> m_hitList;
+		RingBuffer<DPPChannel> m_hitList; //preallocated, holds the hits of the currently open window
+		uint64_t m_overflowCount;
+		uint64_t m_triggerOverflowCount;
+		uint64_t m_outOfOrderCount;
+		uint64_t m_lateDropCount;
+		int m_lastMultiplicity;
+		double m_lastEventTime;
 		bool m_eventFlag;
-		CoincEvent m_event;
-		CoincEvent m_blank;
+		HitEvent m_hitEvent;
+		CoincEvent m_event; //conversion target for GetEvent()
+		BuiltEvent m_builtEvent;
 		
 		double startTime, previousHitTime;    
-		std::unordered_map<DetAttribute, std::vector<DetectorHit>*> varMap;
+
+		//Triggered mode
+		BuildMode m_mode;
+		std::vector<uint8_t> m_isTrigger; //indexed by global channel
+		RingBuffer<double> m_pendingTriggers; //trigger times whose events have not been built
+		double m_preWindow, m_postWindow;
+		double m_lastHitTime;
+		double m_lastWindowEnd; //end of the window of the last built event
+		bool m_flushFlag;
 	
 		TH2F* event_stats;
 	
-		ChannelMap cmap;
+		DetectorRegistry m_registry;
 	 
 	};
 
@@ -0,0 +1,112 @@
+/*
+	SmallVector.h
+	Vector with room for N elements stored inline, spilling to the heap only when it outgrows them. Detector hit
+	lists almost always hold zero to two hits, so keeping them inline removes an allocation and a pointer hop per
+	list. Once spilled, the heap block is kept (and reused) until the vector is destroyed.
+
+	Names follow std::vector so that event code reads the same for either container. Only for trivially copyable
+	element types; elements are copied with memcpy and never destroyed.
+*/
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace EventBuilder {
+
+	template<typename T, std::size_t N>
+	class SmallVector
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types");
+
+	public:
+		SmallVector() :
+			m_data(m_inline), m_size(0), m_capacity(N)
+		{
+		}
+
+		SmallVector(const SmallVector& other) :
+			SmallVector()
+		{
+			assign(other.begin(), other.end());
+		}
+
+		SmallVector& operator=(const SmallVector& other)
+		{
+			if(this != &other)
+				assign(other.begin(), other.end());
+			return *this;
+		}
+
+		~SmallVector() {}
+
+		inline void push_back(const T& value)
+		{
+			if(m_size == m_capacity)
+				Grow(m_capacity*2);
+			m_data[m_size++] = value;
+		}
+
+		void assign(const T* first, const T* last)
+		{
+			std::size_t count = last - first;
+			if(count > m_capacity)
+				Grow(count);
+			if(count > 0)
+				std::memcpy(m_data, first, count*sizeof(T));
+			m_size = count;
+		}
+
+		inline void reserve(std::size_t capacity)
+		{
+			if(capacity > m_capacity)
+				Grow(capacity);
+		}
+
+		inline void clear() { m_size = 0; }
+		inline void pop_back() { --m_size; }
+
+		inline T& operator[](std::size_t i) { return m_data[i]; }
+		inline const T& operator[](std::size_t i) const { return m_data[i]; }
+		inline T& front() { return m_data[0]; }
+		inline const T& front() const { return m_data[0]; }
+		inline T& back() { return m_data[m_size - 1]; }
+		inline const T& back() const { return m_data[m_size - 1]; }
+
+		inline T* data() { return m_data; }
+		inline const T* data() const { return m_data; }
+		inline T* begin() { return m_data; }
+		inline T* end() { return m_data + m_size; }
+		inline const T* begin() const { return m_data; }
+		inline const T* end() const { return m_data + m_size; }
+
+		inline std::size_t size() const { return m_size; }
+		inline std::size_t capacity() const { return m_capacity; }
+		inline bool empty() const { return m_size == 0; }
+		inline bool IsInline() const { return m_data == m_inline; }
+
+		static constexpr std::size_t s_inlineCapacity = N;
+
+	private:
+		void Grow(std::size_t capacity)
+		{
+			std::unique_ptr<T[]> block(new T[capacity]);
+			if(m_size > 0)
+				std::memcpy(block.get(), m_data, m_size*sizeof(T));
+			m_heap = std::move(block);
+			m_data = m_heap.get();
+			m_capacity = capacity;
+		}
+
+		T m_inline[N];
+		std::unique_ptr<T[]> m_heap;
+		T* m_data;
+		std::size_t m_size;
+		std::size_t m_capacity;
+	};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*
+	ThreadTopology.cpp
+	NUMA layout from sysfs and thread pinning. See header.
+*/
+#include "ThreadTopology.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace EventBuilder {
+
+	ThreadTopology& ThreadTopology::GetInstance()
+	{
+		static ThreadTopology topology;
+		return topology;
+	}
+
+	ThreadTopology::ThreadTopology()
+	{
+		ReadNodes();
+		if(m_nodes.empty()) //no sysfs node info, treat the machine as one node
+		{
+			unsigned int ncores = std::max(std::thread::hardware_concurrency(), 1u);
+			m_nodes.emplace_back();
+			m_nodeIDs.push_back(0);
+			for(unsigned int i=0; i<ncores; i++)
+				m_nodes.back().push_back(i);
+		}
+	}
+
+	ThreadTopology::~ThreadTopology() {}
+
+	void ThreadTopology::ReadNodes()
+	{
+		const std::filesystem::path nodeDir("/sys/devices/system/node");
+		std::error_code ec;
+		if(!std::filesystem::is_directory(nodeDir, ec))
+			return;
+
+		//Nodes may be sparsely numbered, so collect by index first
+		std::vector<std::pair<int, std::vector<int>>> nodes;
+		for(auto& entry : std::filesystem::directory_iterator(nodeDir, ec))
+		{
+			std::string name = entry.path().filename().string();
+			if(name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin()+4, name.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+				continue;
+
+			std::ifstream input(entry.path() / "cpulist");
+			std::string list;
+			if(!input.is_open() || !std::getline(input, list))
+				continue;
+			auto cores = ParseCpuList(list);
+			if(!cores.empty()) //memory-only nodes have no cores
+				nodes.emplace_back(std::stoi(name.substr(4)), cores);
+		}
+		std::sort(nodes.begin(), nodes.end());
+		for(auto& node : nodes)
+		{
+			m_nodeIDs.push_back(node.first);
+			m_nodes.push_back(node.second);
+		}
+	}
+
+	//Kernel cpu list format, ex. "0-7,16-23"
+	std::vector<int> ThreadTopology::ParseCpuList(const std::string& list)
+	{
+		std::vector<int> cores;
+		std::stringstream stream(list);
+		std::string range;
+		while(std::getline(stream, range, ','))
+		{
+			if(range.empty() || !std::isdigit(static_cast<unsigned char>(range[0])))
+				continue;
+			std::size_t dash = range.find('-');
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash+1));
+			for(int i=first; i<=last; i++)
+				cores.push_back(i);
+		}
+		return cores;
+	}
+
+	std::string ThreadTopology::FormatCpuList(const std::vector<int>& cores)
+	{
+		std::string list;
+		for(std::size_t i=0; i<cores.size(); i++)
+		{
+			std::size_t j = i;
+			while(j+1 < cores.size() && cores[j+1] == cores[j] + 1)
+				j++;
+			if(!list.empty())
+				list += ",";
+			list += std::to_string(cores[i]);
+			if(j != i)
+				list += "-" + std::to_string(cores[j]);
+			i = j;
+		}
+		return list;
+	}
+
+	bool ThreadTopology::PinCurrentThread(const std::vector<int>& cores)
+	{
+#ifdef __linux__
+		if(cores.empty())
+			return false;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for(int core : cores)
+		{
+			if(core >= 0 && core < CPU_SETSIZE)
+				CPU_SET(core, &set);
+		}
+		int status = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+		if(status != 0)
+		{
+			EVB_WARN("Unable to set thread affinity (error {0}); thread left unpinned.", status);
+			return false;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/*
+		The whole node rather than a single core, so that threads started from the conversion thread (ex. ROOT's
+		compression pool, which inherits the mask) stay on the same node without all sharing one core.
+	*/
+	bool ThreadTopology::PinBuildThread(const ThreadAffinityParameters& params)
+	{
+		if(!params.pinThreads || params.buildNode < 0 || !IsMultiNode())
+			return false;
+		auto iter = std::find(m_nodeIDs.begin(), m_nodeIDs.end(), params.buildNode);
+		if(iter == m_nodeIDs.end())
+		{
+			EVB_WARN("BuildNode {0} is not a NUMA node with cores on this machine. Conversion thread left unpinned.", params.buildNode);
+			return false;
+		}
+		if(PinCurrentThread(m_nodes[iter - m_nodeIDs.begin()]))
+		{
+			EVB_INFO("Pinned conversion thread to NUMA node {0}.", params.buildNode);
+			return true;
+		}
+		return false;
+	}
+
+	bool ThreadTopology::PinWorkerThread(int worker, const ThreadAffinityParameters& params)
+	{
+		if(!params.pinThreads)
+			return false;
+		if(!params.workerCores.empty())
+			return PinCurrentThread({ params.workerCores[worker % params.workerCores.size()] });
+		if(!IsMultiNode())
+			return false;
+		return PinCurrentThread(m_nodes[worker % m_nodes.size()]);
+	}
+
+	ThreadAffinityGuard::ThreadAffinityGuard()
+	{
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0)
+			return;
+		for(int core=0; core<CPU_SETSIZE; core++)
+		{
+			if(CPU_ISSET(core, &set))
+				m_cores.push_back(core);
+		}
+#endif
+	}
+
+	ThreadAffinityGuard::~ThreadAffinityGuard()
+	{
+		if(!m_cores.empty())
+			ThreadTopology::PinCurrentThread(m_cores);
+	}
+
+}
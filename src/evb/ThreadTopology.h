@@ -0,0 +1,70 @@
+/*
+	ThreadTopology.h
+	Core/NUMA layout of the machine, read once from /sys/devices/system/node, and pinning of the event builder's
+	threads to it. The conversion thread (which reads the CompassFiles and sorts) can be held to one NUMA node, and
+	the parallel workers of Reanalyze/TuneNudge and of the analyzed conversions are either given explicit cores or
+	spread round-robin over the nodes. The conversion thread gets its original mask back when the conversion ends
+	(see ThreadAffinityGuard); Scan's threads are not pinned. Memory placement relies on the kernel's first-touch
+	policy: threads are pinned before they allocate their buffers and event pools, so those pages land on the
+	thread's own node.
+
+	On single-node machines (or anywhere the layout can't be read) every call is a no-op unless cores are given
+	explicitly.
+*/
+#ifndef THREAD_TOPOLOGY_H
+#define THREAD_TOPOLOGY_H
+
+namespace EventBuilder {
+
+	struct ThreadAffinityParameters
+	{
+		bool pinThreads = false; //master switch
+		int buildNode = -1; //kernel NUMA node id (as in /sys/devices/system/node/nodeN) for the conversion thread; -1 leaves it unpinned
+		std::vector<int> workerCores; //cores for parallel workers, used in order; empty spreads workers over the nodes
+	};
+
+	class ThreadTopology
+	{
+	public:
+		static ThreadTopology& GetInstance();
+
+		inline std::size_t GetNumberOfNodes() const { return m_nodes.size(); }
+		inline const std::vector<int>& GetNodeCores(std::size_t node) const { return m_nodes[node]; }
+		inline int GetNodeID(std::size_t node) const { return m_nodeIDs[node]; } //kernel id; nodes may be sparsely numbered
+		inline bool IsMultiNode() const { return m_nodes.size() > 1; }
+
+		bool PinBuildThread(const ThreadAffinityParameters& params); //call before the conversion allocates its buffers
+		bool PinWorkerThread(int worker, const ThreadAffinityParameters& params); //call first thing in the worker
+
+		static bool PinCurrentThread(const std::vector<int>& cores);
+		static std::string FormatCpuList(const std::vector<int>& cores); //inverse of the kernel list format, ex. "0-7,16-23"
+
+	private:
+		ThreadTopology();
+		~ThreadTopology();
+		ThreadTopology(const ThreadTopology&) = delete;
+		ThreadTopology& operator=(const ThreadTopology&) = delete;
+
+		void ReadNodes();
+		static std::vector<int> ParseCpuList(const std::string& list);
+
+		std::vector<std::vector<int>> m_nodes; //cores of each NUMA node with cores, in kernel id order
+		std::vector<int> m_nodeIDs; //kernel id of each entry of m_nodes
+	};
+
+	//Saves the calling thread's affinity on construction and restores it on destruction
+	class ThreadAffinityGuard
+	{
+	public:
+		ThreadAffinityGuard();
+		~ThreadAffinityGuard();
+		ThreadAffinityGuard(const ThreadAffinityGuard&) = delete;
+		ThreadAffinityGuard& operator=(const ThreadAffinityGuard&) = delete;
+
+	private:
+		std::vector<int> m_cores; //empty if the mask couldn't be read, in which case nothing is restored
+	};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+	TreeWriter.cpp
+	Batched TTree filling with sized clusters and parallel compression. See header.
+*/
+#include "TreeWriter.h"
+#include <algorithm>
+
+namespace EventBuilder {
+
+	int TreeWriter::s_compressionThreads = -1;
+
+	TreeWriter::TreeWriter(TTree* tree) :
+		m_tree(tree), m_start(Clock::now())
+	{
+		//Negative AutoFlush is in bytes: a few large clusters, each one batch of baskets for the compression threads
+		m_tree->SetAutoFlush(-s_clusterBytes);
+	}
+
+	TreeWriter::~TreeWriter() {}
+
+	/*
+		Implicit MT is process wide (and used by every tree), so this is set from the parameters rather than per tree.
+		The pool can't be resized, so a new thread count restarts it.
+	*/
+	void TreeWriter::EnableCompressionThreads(int nThreads)
+	{
+		nThreads = std::max(nThreads, 0);
+		bool isChanged = nThreads != s_compressionThreads;
+		s_compressionThreads = nThreads;
+		if(ROOT::IsImplicitMTEnabled() && (nThreads == 1 || isChanged))
+			ROOT::DisableImplicitMT();
+		if(nThreads == 1 || ROOT::IsImplicitMTEnabled())
+			return;
+		ROOT::EnableImplicitMT(nThreads);
+		EVB_INFO("Enabled ROOT implicit multithreading with {0} threads for output compression.", ROOT::GetThreadPoolSize());
+	}
+
+	void TreeWriter::Write()
+	{
+		m_tree->Write(m_tree->GetName(), TObject::kOverwrite);
+		double seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+
+		double totalMB = m_tree->GetTotBytes()/1.0e6;
+		double zipMB = m_tree->GetZipBytes()/1.0e6;
+		if(seconds > 0.0)
+		{
+			EVB_INFO("Wrote {0} entries to {1}: {2:.1f} MB ({3:.1f} MB compressed) in {4:.2f} s, {5:.1f} MB/s, {6:.0f} entries/s.", m_tree->GetEntries(),
+					 m_tree->GetName(), totalMB, zipMB, seconds, totalMB/seconds, m_tree->GetEntries()/seconds);
+		}
+	}
+
+}
@@ -0,0 +1,41 @@
+/*
+	TreeWriter.h
+	Thin wrapper around filling an output TTree. Clusters (AutoFlush) are set by uncompressed size, larger than
+	ROOT's default, so that baskets are flushed in a few large batches; ROOT sizes the baskets to the cluster at
+	the first flush. Event trees hold a varying number of hits per entry, so a size is used rather than an entry
+	count. With ROOT implicit multithreading on (see EnableCompressionThreads(), set once by EVBApp), each batch
+	is compressed in parallel on the thread pool rather than serially on the event building thread. The time from
+	creating the writer to writing the tree, and the resulting throughput, are reported when the tree is written;
+	individual fills are not timed, to keep the clock out of the per-entry path.
+*/
+#ifndef TREE_WRITER_H
+#define TREE_WRITER_H
+
+#include <chrono>
+
+namespace EventBuilder {
+
+	class TreeWriter
+	{
+	public:
+		TreeWriter(TTree* tree);
+		~TreeWriter();
+		inline void Fill() { m_tree->Fill(); }
+		void Write(); //write the tree to its directory and report throughput
+
+		static void EnableCompressionThreads(int nThreads); //process wide; 0 = all hardware threads, 1 = serial
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		TTree* m_tree;
+		Clock::time_point m_start;
+
+		static int s_compressionThreads; //as last requested; -1 before the first request
+
+		static constexpr Long64_t s_clusterBytes = 128*1024*1024; //uncompressed; ROOT's default is 30 MB
+	};
+
+}
+
+#endif
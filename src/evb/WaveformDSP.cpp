@@ -0,0 +1,133 @@
+/*
+	WaveformDSP.cpp
+	Baseline, trapezoid energy, and CFD timing for CoMPASS waveforms. The inner loops are plain
+	indexed loops over contiguous float arrays so that they auto-vectorize in Release builds.
+*/
+#include "WaveformDSP.h"
+#include <algorithm>
+#include <cmath>
+
+namespace EventBuilder {
+
+	WaveformDSP::WaveformDSP(const WaveDSPParameters& params) :
+		m_params(params), m_baselineSigma(0.0f)
+	{
+		m_params.baselineSamples = std::max(m_params.baselineSamples, 1);
+		m_params.trapRise = std::max(m_params.trapRise, 1);
+		m_params.trapFlat = std::max(m_params.trapFlat, 0);
+		m_params.cfdDelay = std::max(m_params.cfdDelay, 1);
+	}
+
+	WaveformDSP::~WaveformDSP() {}
+
+	void WaveformDSP::Process(const uint16_t* samples, uint32_t nsamples, CompassHit& hit)
+	{
+		if(nsamples == 0)
+		{
+			hit.waveBaseline = 0.0f;
+			hit.waveEnergy = 0.0f;
+			hit.waveTime = -1.0f;
+			return;
+		}
+
+		if(m_signal.size() < nsamples)
+		{
+			m_signal.resize(nsamples);
+			m_integral.resize(nsamples + 1);
+			m_cfd.resize(nsamples);
+		}
+
+		hit.waveBaseline = CalculateBaseline(samples, nsamples);
+
+		const float polarity = m_params.polarity < 0 ? -1.0f : 1.0f;
+		const float baseline = hit.waveBaseline;
+		float* signal = m_signal.data();
+		for(uint32_t i=0; i<nsamples; i++)
+			signal[i] = polarity * (float(samples[i]) - baseline);
+
+		hit.waveEnergy = CalculateTrapezoidEnergy(nsamples);
+		hit.waveTime = CalculateCFDTime(nsamples);
+
+		if(m_params.replaceEnergy)
+			hit.energy = uint16_t(std::min(std::max(hit.waveEnergy + 0.5f, 0.0f), 65535.0f));
+	}
+
+	float WaveformDSP::CalculateBaseline(const uint16_t* samples, uint32_t nsamples)
+	{
+		uint32_t n = std::min<uint32_t>(m_params.baselineSamples, nsamples);
+		uint64_t sum = 0, sumSquares = 0;
+		for(uint32_t i=0; i<n; i++)
+		{
+			sum += samples[i];
+			sumSquares += uint64_t(samples[i])*samples[i];
+		}
+		double mean = double(sum)/n;
+		m_baselineSigma = std::sqrt(std::max(double(sumSquares)/n - mean*mean, 0.0));
+		return float(mean);
+	}
+
+	/*
+		Trapezoid from the running integral: T[n] = (S[n] - S[n-L]) - (S[n-L-G] - S[n-2L-G]),
+		where L is the rise and G the flat top. Energy is the trapezoid maximum normalized by L.
+		No pole-zero correction is applied, so the flat top should be short relative to the decay.
+	*/
+	float WaveformDSP::CalculateTrapezoidEnergy(uint32_t nsamples)
+	{
+		const uint32_t rise = m_params.trapRise;
+		const uint32_t gap = rise + m_params.trapFlat;
+		const uint32_t span = gap + rise;
+
+		float* integral = m_integral.data();
+		integral[0] = 0.0f;
+		for(uint32_t i=0; i<nsamples; i++)
+			integral[i+1] = integral[i] + m_signal[i];
+
+		if(nsamples < span) //waveform too short for the requested filter
+			return 0.0f;
+
+		float peak = 0.0f;
+		for(uint32_t n=span; n<=nsamples; n++)
+		{
+			float trap = (integral[n] - integral[n-rise]) - (integral[n-gap] - integral[n-span]);
+			peak = std::max(peak, trap);
+		}
+		return peak/rise;
+	}
+
+	/*
+		Classic CFD: C[n] = f*x[n] - x[n-d]. The discriminator arms at the first sample above the threshold (a few
+		baseline sigmas, and a small fraction of the peak), where C is positive on the leading edge. The timing is the
+		first positive-to-negative zero crossing from there, up to d samples past the signal maximum, linearly
+		interpolated between samples. No delay is added to the returned time.
+	*/
+	float WaveformDSP::CalculateCFDTime(uint32_t nsamples)
+	{
+		const uint32_t delay = m_params.cfdDelay;
+		if(nsamples <= delay + 1)
+			return -1.0f;
+
+		const float fraction = m_params.cfdFraction;
+		const float* signal = m_signal.data();
+		float* cfd = m_cfd.data();
+		for(uint32_t n=delay; n<nsamples; n++)
+			cfd[n] = fraction*signal[n] - signal[n-delay];
+
+		uint32_t peakIndex = std::max_element(signal, signal + nsamples) - signal;
+		const float threshold = std::max(s_armSigmas*m_baselineSigma, s_armPeakFraction*signal[peakIndex]);
+		uint32_t armIndex = 0;
+		while(armIndex < peakIndex && signal[armIndex] <= threshold)
+			armIndex++;
+
+		uint32_t stop = std::min(nsamples, peakIndex + delay + 1);
+		for(uint32_t n=std::max(armIndex, delay)+1; n<stop; n++)
+		{
+			if(cfd[n-1] > 0.0f && cfd[n] <= 0.0f)
+			{
+				float frac = cfd[n-1]/(cfd[n-1] - cfd[n]);
+				return (float(n-1) + frac)*m_params.samplePeriod;
+			}
+		}
+		return -1.0f;
+	}
+
+}
@@ -0,0 +1,53 @@
+/*
+	WaveformDSP.h
+	Simple digital signal processing for CoMPASS waveforms, run on the fly as hits are parsed.
+	Extracts a baseline (mean of the leading samples), a trapezoidal filter energy, and a constant
+	fraction discriminator (CFD) time, armed by a threshold above the baseline noise. All scratch storage is owned by the class and reused from
+	hit to hit, so no whole-file buffering or per-hit allocation is required.
+
+	Times are returned in ns relative to the first sample of the waveform.
+*/
+#ifndef WAVEFORM_DSP_H
+#define WAVEFORM_DSP_H
+
+#include "CompassHit.h"
+
+namespace EventBuilder {
+
+	struct WaveDSPParameters
+	{
+		int baselineSamples = 16; //number of leading samples averaged for the baseline
+		int trapRise = 20; //trapezoid rise time in samples
+		int trapFlat = 10; //trapezoid flat top in samples
+		double cfdFraction = 0.3;
+		int cfdDelay = 4; //in samples
+		double samplePeriod = 2.0; //ns per sample (V1730 = 2, V1725 = 4)
+		int polarity = 1; //+1 for positive pulses, -1 for negative pulses
+		bool replaceEnergy = false; //overwrite the CoMPASS energy with the trapezoid energy
+	};
+
+	class WaveformDSP
+	{
+	public:
+		WaveformDSP(const WaveDSPParameters& params);
+		~WaveformDSP();
+		void Process(const uint16_t* samples, uint32_t nsamples, CompassHit& hit);
+
+	private:
+		float CalculateBaseline(const uint16_t* samples, uint32_t nsamples);
+		float CalculateTrapezoidEnergy(uint32_t nsamples);
+		float CalculateCFDTime(uint32_t nsamples);
+
+		WaveDSPParameters m_params;
+		float m_baselineSigma; //standard deviation of the baseline samples of the current waveform
+		std::vector<float> m_signal; //baseline subtracted, polarity corrected samples
+		std::vector<float> m_integral; //running sum of m_signal, used by the trapezoid
+		std::vector<float> m_cfd;
+
+		static constexpr float s_armSigmas = 5.0f; //CFD arms once the signal is this many baseline sigmas above the baseline
+		static constexpr float s_armPeakFraction = 0.05f; //and at least this fraction of the peak, for noiseless baselines
+	};
+
+}
+
+#endif
@@ -218,9 +218,13 @@ EVBMainFrame::EVBMainFrame(const TGWindow* p, UInt_t w, UInt_t h) :
 	fTypeBox->AddEntry("Convert Fast", EventBuilder::EVBApp::Operation::ConvertFast);
 	fTypeBox->AddEntry("Convert SlowA", EventBuilder::EVBApp::Operation::ConvertSlowA);
 	fTypeBox->AddEntry("Convert FastA", EventBuilder::EVBApp::Operation::ConvertFastA);
+	fTypeBox->AddEntry("Convert FastA + Plot", EventBuilder::EVBApp::Operation::ConvertFastAPlot);
 	fTypeBox->AddEntry("Convert", EventBuilder::EVBApp::Operation::Convert);
 	fTypeBox->AddEntry("Merge ROOT", EventBuilder::EVBApp::Operation::Merge);
 	fTypeBox->AddEntry("Plot", EventBuilder::EVBApp::Operation::Plot);
+	fTypeBox->AddEntry("Reaction Scan", EventBuilder::EVBApp::Operation::Scan);
+	fTypeBox->AddEntry("Reanalyze", EventBuilder::EVBApp::Operation::Reanalyze);
+	fTypeBox->AddEntry("Tune Nudge", EventBuilder::EVBApp::Operation::Tune);
 	fTypeBox->Resize(200,20);
 	fTypeBox->Connect("Selected(Int_t, Int_t)","EVBMainFrame",this,"HandleTypeSelection(Int_t,Int_t)");
 	opFrame->AddFrame(typelabel, lhints);
@@ -400,6 +404,26 @@ void EVBMainFrame::DoRun()
 			m_builder.Convert2FastAnalyzedRoot();
 			break;
 		}
+		case EventBuilder::EVBApp::Operation::ConvertFastAPlot :
+		{
+			m_builder.RunOperationChain({"ConvertFastA", "Plot"});
+			break;
+		}
+		case EventBuilder::EVBApp::Operation::Scan :
+		{
+			m_builder.ScanReaction();
+			break;
+		}
+		case EventBuilder::EVBApp::Operation::Reanalyze :
+		{
+			m_builder.ReanalyzeBuiltFiles();
+			break;
+		}
+		case EventBuilder::EVBApp::Operation::Tune :
+		{
+			m_builder.TuneNudge();
+			break;
+		}
 	}
 
 	EnableAllInput();
@@ -2,6 +2,7 @@
 #include "spsdict/DataStructs.h"
 #include "evb/EVBApp.h"
 #include "evb/Stopwatch.h"
+#include <sstream>
 
 int main(int argc, char** argv) 
 {
@@ -16,6 +17,16 @@ int main(int argc, char** argv)
 	std::string filename = argv[2];
 	std::string operation = argv[1];
 
+	//Operations can be chained with commas, ex. ConvertFastA,Merge,Plot; RunOperationChain validates them
+	std::vector<std::string> operations;
+	std::stringstream opstream(operation);
+	std::string op;
+	while(std::getline(opstream, op, ','))
+	{
+		if(!op.empty())
+			operations.push_back(op);
+	}
+
 
 	/* DEFAULT Operation Types:
 		Convert (convert binary archive to root data)
@@ -25,6 +36,15 @@ int main(int argc, char** argv)
 		ConvertFastA (convert binary archive to analyzed fast event data)
 		Merge (combine root files)
 		Plot (generate a default histogram file from analyzed data)
+		Scan (evaluate focal plane shift and weights over a kinematic grid)
+		Reanalyze (analyze existing event built files with new kinematic parameters)
+		TuneNudge (find the nudge giving the narrowest xavg peak from built files)
+
+		Several operations may be given as a comma separated list and are run in order with the same input file.
+		ConvertSlowA/ConvertFastA followed by Merge and/or Plot is done in a single pass over the data, ex.
+		ConvertFastA,Merge,Plot converts, merges, and histograms without re-reading the analyzed files.
+		With WriteAnalyzedTree: false in the config, ConvertFastA,Plot fills histograms straight from the
+		analyzer and never writes the analyzed tree at all.
 	*/
 
 	EventBuilder::EVBApp theBuilder;
@@ -33,25 +53,8 @@ int main(int argc, char** argv)
 
 	EventBuilder::Stopwatch timer;
 	timer.Start();
-	if(operation == "Convert")
-		theBuilder.Convert2RawRoot();
-	else if(operation == "Merge")
-		theBuilder.MergeROOTFiles();
-	else if(operation == "Plot")
-		theBuilder.PlotHistograms();
-	else if (operation == "ConvertSlow")
-		theBuilder.Convert2SortedRoot();
-	else if (operation == "ConvertFast")
-		theBuilder.Convert2FastSortedRoot();
-	else if (operation == "ConvertSlowA")
-		theBuilder.Convert2SlowAnalyzedRoot();
-	else if (operation == "ConvertFastA")
-		theBuilder.Convert2FastAnalyzedRoot();
-	else 
-	{
-		EVB_ERROR("Invalid operation {0} given to EventBuilder! Exiting.", operation);
+	if(!theBuilder.RunOperationChain(operations))
 		return 1;
-	}
 	
 	timer.Stop();
 	EVB_INFO("Elapsed time (ms): {0}", timer.GetElapsedMilliseconds());
@@ -53,6 +53,20 @@ struct CoincEvent
   CATRINADetector catrinaArray[7]; //index = ChannelMap Id# -1, JCE 2025
 };
 
+/*
+  Compact on-disk form of CoincEvent, used for built files when CompactBuiltFiles is set (see evb/CompactEvent.h).
+  Hits from every detector list are stored flat; list is the index of the CoincEvent list each hit belongs to.
+  Times are integer ps, delta encoded hit to hit.
+*/
+struct CompactEvent
+{
+  long long startTime = 0; //ps, time of the first stored hit
+  std::vector<unsigned char> list;
+  std::vector<unsigned short> channel;
+  std::vector<unsigned short> energy, energyShort;
+  std::vector<int> deltaTime; //ps, relative to the previous stored hit (startTime for the first)
+};
+
 struct ProcessedEvent 
 {
   double fp1_tdiff = -1e6, fp2_tdiff = -1e6, fp1_tsum = -1, fp2_tsum = -1,
@@ -112,6 +126,9 @@ struct ProcessedEvent
   double catrinaE[7] = {-1,-1,-1,-1,-1,-1,-1};
   double catrinaChannel[7] = {-1,-1,-1,-1,-1,-1,-1};
   double catrinaTime[7] = {-1,-1,-1,-1,-1,-1,-1};
+  double catrinaShort[7] = {-1,-1,-1,-1,-1,-1,-1};
+  double catrinaPSD[7] = {-1,-1,-1,-1,-1,-1,-1}; //tail/total, (Long - Short)/Long
+  double catrinaParticle[7] = {-1,-1,-1,-1,-1,-1,-1}; //1 neutron, 0 gamma, -1 none
 
   double catrinaE0 = -1;
   double catrinaE1 = -1;
@@ -4,8 +4,10 @@
 #pragma link C++ struct DetectorHit+;
 #pragma link C++ class  std::vector<DetectorHit>+;
 #pragma link C++ struct SabreDetector+;
+#pragma link C++ struct CATRINADetector+;
 #pragma link C++ struct FPDetector+;
 #pragma link C++ struct CoincEvent+;
+#pragma link C++ struct CompactEvent+;
 #pragma link C++ struct ProcessedEvent+;
 
 #endif